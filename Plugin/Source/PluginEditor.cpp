@@ -0,0 +1,48 @@
+#include <JuceHeader.h>
+#include "PluginEditor.h"
+
+ZonifierAudioProcessorEditor::ZonifierAudioProcessorEditor(ZonifierAudioProcessor& p)
+	: AudioProcessorEditor(&p), processor(p), files(p.getSetlist())
+{
+	addAndMakeVisible(files);
+	files.addListener(this);
+	files.updateKeyboardName();
+	processor.addChangeListener(this);
+
+	setSize(EDITOR_WIDTH, EDITOR_HEIGHT);
+}
+
+ZonifierAudioProcessorEditor::~ZonifierAudioProcessorEditor()
+{
+	processor.removeChangeListener(this);
+	files.removeAllListeners();
+}
+
+void ZonifierAudioProcessorEditor::paint(Graphics& g)
+{
+	g.fillAll(Colours::black);
+}
+
+void ZonifierAudioProcessorEditor::resized()
+{
+	files.setBounds(getLocalBounds());
+}
+
+void ZonifierAudioProcessorEditor::actionListenerCallback(const String& message)
+{
+	if (message.compare("openDirectory") == 0) {
+		processor.setlistLoaded();
+	}
+	else if (message.compare("loadCCMapping") == 0) {
+		processor.ccMappingLoaded();
+	}
+	else if (message.compare("loadPreviousFile") == 0 || message.compare("loadNextFile") == 0) {
+		processor.requestConfiguration(files.getCurrentFileIdx());
+	}
+}
+
+void ZonifierAudioProcessorEditor::changeListenerCallback(ChangeBroadcaster* /*source*/)
+{
+	files.updateCurrentFileName();
+	files.updateKeyboardName();
+}
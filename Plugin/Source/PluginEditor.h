@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/FilesComponent.h"
+#include "PluginProcessor.h"
+
+#define EDITOR_WIDTH 500
+#define EDITOR_HEIGHT 350
+
+class ZonifierAudioProcessorEditor    : public AudioProcessorEditor, private ActionListener, ChangeListener
+{
+public:
+	ZonifierAudioProcessorEditor(ZonifierAudioProcessor& p);
+	~ZonifierAudioProcessorEditor();
+
+	void paint(Graphics&) override;
+	void resized() override;
+
+private:
+	void actionListenerCallback(const String& message) override;
+	void changeListenerCallback(ChangeBroadcaster* source) override;
+
+	ZonifierAudioProcessor& processor;
+
+	// Zone File Management
+	FilesComponent files;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZonifierAudioProcessorEditor)
+};
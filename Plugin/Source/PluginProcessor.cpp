@@ -0,0 +1,153 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+ZonifierAudioProcessor::ZonifierAudioProcessor() : AudioProcessor(BusesProperties())
+{
+}
+
+ZonifierAudioProcessor::~ZonifierAudioProcessor()
+{
+	cancelPendingUpdate();
+}
+
+void ZonifierAudioProcessor::prepareToPlay(double sampleRate, int /*samplesPerBlock*/)
+{
+	blockProcessor.prepare(sampleRate);
+}
+
+void ZonifierAudioProcessor::releaseResources()
+{
+}
+
+void ZonifierAudioProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+	buffer.clear();
+	// The arpeggiated zones follow the tempo of the host
+	AudioPlayHead::CurrentPositionInfo position;
+	if (getPlayHead() != nullptr && getPlayHead()->getCurrentPosition(position)) blockProcessor.setTempo(position.bpm);
+	// The setlist and the editor are updated on the message thread
+	if (blockProcessor.processBlock(midiMessages, buffer.getNumSamples())) triggerAsyncUpdate();
+}
+
+void ZonifierAudioProcessor::handleAsyncUpdate()
+{
+	setlist.selectFile(router.getCurrentConfigurationIdx());
+	sendChangeMessage();
+}
+
+AudioProcessorEditor* ZonifierAudioProcessor::createEditor()
+{
+	return new ZonifierAudioProcessorEditor(*this);
+}
+
+bool ZonifierAudioProcessor::hasEditor() const
+{
+	return true;
+}
+
+const String ZonifierAudioProcessor::getName() const
+{
+	return JucePlugin_Name;
+}
+
+bool ZonifierAudioProcessor::acceptsMidi() const
+{
+	return true;
+}
+
+bool ZonifierAudioProcessor::producesMidi() const
+{
+	return true;
+}
+
+bool ZonifierAudioProcessor::isMidiEffect() const
+{
+	return true;
+}
+
+double ZonifierAudioProcessor::getTailLengthSeconds() const
+{
+	return 0.0;
+}
+
+int ZonifierAudioProcessor::getNumPrograms()
+{
+	return 1;
+}
+
+int ZonifierAudioProcessor::getCurrentProgram()
+{
+	return 0;
+}
+
+void ZonifierAudioProcessor::setCurrentProgram(int /*index*/)
+{
+}
+
+const String ZonifierAudioProcessor::getProgramName(int /*index*/)
+{
+	return {};
+}
+
+void ZonifierAudioProcessor::changeProgramName(int /*index*/, const String& /*newName*/)
+{
+}
+
+void ZonifierAudioProcessor::getStateInformation(MemoryBlock& destData)
+{
+	XmlElement state("ZONIFIER");
+	state.setAttribute("directory", setlist.getDirectory().getFullPathName());
+	state.setAttribute("ccMappingFile", setlist.getCCMappingFile().getFullPathName());
+	state.setAttribute("currentFile", router.getCurrentConfigurationIdx());
+	copyXmlToBinary(state, destData);
+}
+
+void ZonifierAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+	std::unique_ptr<XmlElement> state(getXmlFromBinary(data, sizeInBytes));
+	if (state == nullptr || !state->hasTagName("ZONIFIER")) return;
+	String directory = state->getStringAttribute("directory");
+	if (directory.isNotEmpty() && setlist.loadDirectory(File(directory))) {
+		setlistLoaded();
+		requestConfiguration(state->getIntAttribute("currentFile"));
+	}
+	String ccMappingFile = state->getStringAttribute("ccMappingFile");
+	if (ccMappingFile.isNotEmpty() && setlist.loadCCMappingFile(File(ccMappingFile))) {
+		ccMappingLoaded();
+	}
+	sendChangeMessage();
+}
+
+Setlist& ZonifierAudioProcessor::getSetlist()
+{
+	return setlist;
+}
+
+void ZonifierAudioProcessor::setlistLoaded()
+{
+	// The plugin has a single MIDI output, every "outDevice" goes to it
+	router.setConfigurations(setlist.getConfigurations());
+	requestConfiguration(setlist.getCurrentFileIdx());
+}
+
+void ZonifierAudioProcessor::ccMappingLoaded()
+{
+	router.setCCMapping(setlist.getCCMapping());
+}
+
+void ZonifierAudioProcessor::requestConfiguration(int configurationIdx)
+{
+	blockProcessor.requestConfiguration(configurationIdx);
+}
+
+int ZonifierAudioProcessor::getNumDropped()
+{
+	return blockProcessor.getNumDropped();
+}
+
+//==============================================================================
+AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+	return new ZonifierAudioProcessor();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/Setlist.h"
+#include "../../Source/ZoneRouter.h"
+#include "../../Source/MidiBlockProcessor.h"
+
+// The tools project builds the processor, without the plugin settings, to drive it as a host does
+#ifndef JucePlugin_Name
+ #define JucePlugin_Name "MIDI Zonifier"
+#endif
+
+// Runs the Zonifier routing on the host MidiBuffer, one block at a time,
+// keeping the sample offsets of the events; the arpeggiator follows the tempo of the host
+class ZonifierAudioProcessor    : public AudioProcessor, public ChangeBroadcaster, private AsyncUpdater
+{
+public:
+	ZonifierAudioProcessor();
+	~ZonifierAudioProcessor();
+
+	void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+	void releaseResources() override;
+	void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+	AudioProcessorEditor* createEditor() override;
+	bool hasEditor() const override;
+
+	const String getName() const override;
+	bool acceptsMidi() const override;
+	bool producesMidi() const override;
+	bool isMidiEffect() const override;
+	double getTailLengthSeconds() const override;
+
+	int getNumPrograms() override;
+	int getCurrentProgram() override;
+	void setCurrentProgram(int index) override;
+	const String getProgramName(int index) override;
+	void changeProgramName(int index, const String& newName) override;
+
+	void getStateInformation(MemoryBlock& destData) override;
+	void setStateInformation(const void* data, int sizeInBytes) override;
+
+	// Called from the message thread after the setlist has changed
+	Setlist& getSetlist();
+	void setlistLoaded();
+	void ccMappingLoaded();
+	void requestConfiguration(int configurationIdx);
+	// Routed events that did not fit in a block
+	int getNumDropped();
+
+private:
+	void handleAsyncUpdate() override;
+
+	Setlist setlist;
+	ZoneRouter router;
+	MidiBlockProcessor blockProcessor { router };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZonifierAudioProcessor)
+};
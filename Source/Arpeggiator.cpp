@@ -0,0 +1,366 @@
+#include <JuceHeader.h>
+#include "Arpeggiator.h"
+#if JUCE_WINDOWS
+#include <Windows.h>
+#endif
+
+Arpeggiator::Arpeggiator(ZoneRouter::Output& o, bool ownThread) : Thread("Arpeggiator"), output(o), hasOwnThread(ownThread), fifo(ARPEGGIATOR_QUEUE_SIZE), queue(ARPEGGIATOR_QUEUE_SIZE), voices(MAX_ARPEGGIATORS)
+{
+	for (auto& voice : voices) voice.noteOffTimes.fill(0.0);
+	if (hasOwnThread) startThread(ARPEGGIATOR_THREAD_PRIORITY);
+}
+
+Arpeggiator::~Arpeggiator()
+{
+	signalThreadShouldExit();
+	eventsAvailable.signal();
+	stopThread(ARPEGGIATOR_IDLE_WAIT_MS * 10);
+	// No note is left sounding on the outputs
+	for (auto& voice : voices) endAllNotes(voice, getEventTime());
+}
+
+void Arpeggiator::run()
+{
+#if JUCE_WINDOWS
+	// The default timer resolution would make the thread oversleep by up to 15 ms
+	timeBeginPeriod(1);
+#endif
+	while (!threadShouldExit()) {
+		readEvents();
+		const double nextTime = playDueNotes(getCurrentTime());
+		const double waitTime = nextTime - getCurrentTime();
+		if (nextTime <= 0.0) eventsAvailable.wait(ARPEGGIATOR_IDLE_WAIT_MS);
+		else if (waitTime > ARPEGGIATOR_SPIN_TIME) eventsAvailable.wait(jmax(1, (int)((waitTime - ARPEGGIATOR_SPIN_TIME) * 1000.0)));
+		else if (waitTime > 0.0) Thread::yield();
+	}
+#if JUCE_WINDOWS
+	timeEndPeriod(1);
+#endif
+}
+
+void Arpeggiator::noteOn(const Zone& zone, int noteNumber, uint8 velocity)
+{
+	if (noteNumber < MIN_NOTE_NUMBER || noteNumber > MAX_NOTE_NUMBER) return;
+	pushEvent({ Event::noteOnEvent, zone.arpeggiatorSlot, noteNumber, velocity, zone.outChannel, zone.outPort, zone.arpeggiator, getEventTime() });
+}
+
+void Arpeggiator::noteOff(const Zone& zone, int noteNumber)
+{
+	if (noteNumber < MIN_NOTE_NUMBER || noteNumber > MAX_NOTE_NUMBER) return;
+	pushEvent({ Event::noteOffEvent, zone.arpeggiatorSlot, noteNumber, 0, zone.outChannel, zone.outPort, zone.arpeggiator, getEventTime() });
+}
+
+void Arpeggiator::stopAll()
+{
+	pushEvent({ Event::stopEvent, 0, 0, 0, DEFAULT_OUT_CHANNEL, DEFAULT_OUTPUT_PORT, ArpeggiatorSettings(), getEventTime() });
+}
+
+double Arpeggiator::advanceTo(double time)
+{
+	jassert(!hasOwnThread);
+	readEvents();
+	// One step per voice at a time, so that every step is played on its own time
+	double nextTime = playDueNotes(clockTime.load());
+	while (nextTime > 0.0 && nextTime <= time) nextTime = playDueNotes(nextTime);
+	clockTime = time;
+	return nextTime;
+}
+
+void Arpeggiator::handleSyncMessage(const MidiMessage& message, double time)
+{
+	if (message.isMidiClock()) {
+		clockTick(time);
+	}
+	else if (message.isMidiStart()) {
+		// The next clock is the first one of the song
+		gridStartTime.store(0.0);
+		nextClockNumber.store(0);
+		isSongPlaying.store(true);
+	}
+	else if (message.isMidiContinue()) {
+		isSongPlaying.store(true);
+	}
+	else if (message.isSongPositionPointer()) {
+		gridStartTime.store(0.0);
+		nextClockNumber.store((int64)message.getSongPositionPointerMidiBeat() * MIDI_CLOCKS_PER_SONG_POSITION);
+	}
+	else if (message.isMidiStop()) {
+		isSongPlaying.store(false);
+		gridStartTime.store(0.0);
+		stopAll();
+	}
+}
+
+void Arpeggiator::setTempo(double beatsPerMinute)
+{
+	if (beatsPerMinute < MIN_ARPEGGIATOR_TEMPO || beatsPerMinute > MAX_ARPEGGIATOR_TEMPO) return;
+	beatLength.store(60.0 / beatsPerMinute);
+}
+
+double Arpeggiator::getTempo()
+{
+	return 60.0 / beatLength.load();
+}
+
+int64 Arpeggiator::getNumPlayedSteps()
+{
+	return numPlayedSteps.load(std::memory_order_relaxed);
+}
+
+double Arpeggiator::getMeanLateness()
+{
+	const int64 numSteps = numPlayedSteps.load(std::memory_order_relaxed);
+	return numSteps > 0 ? totalLateness.load(std::memory_order_relaxed) / (numSteps * 1000.0) : 0.0;
+}
+
+double Arpeggiator::getMaxLateness()
+{
+	return maxLateness.load(std::memory_order_relaxed) / 1000.0;
+}
+
+void Arpeggiator::resetTimingStats()
+{
+	numPlayedSteps.store(0, std::memory_order_relaxed);
+	totalLateness.store(0, std::memory_order_relaxed);
+	maxLateness.store(0, std::memory_order_relaxed);
+}
+
+double Arpeggiator::getCurrentTime()
+{
+	return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+double Arpeggiator::getEventTime()
+{
+	return hasOwnThread ? getCurrentTime() : clockTime.load();
+}
+
+void Arpeggiator::pushEvent(const Event& event)
+{
+	if (event.slot < 0 || event.slot >= MAX_ARPEGGIATORS) return;
+	{
+		const SpinLock::ScopedLockType sl(writeLock);
+		int start1, size1, start2, size2;
+		fifo.prepareToWrite(1, start1, size1, start2, size2);
+		if (size1 + size2 == 0) return; // Queue full, the note is dropped
+		queue[size1 > 0 ? start1 : start2] = event;
+		fifo.finishedWrite(1);
+	}
+	eventsAvailable.signal();
+}
+
+void Arpeggiator::readEvents()
+{
+	int start1, size1, start2, size2;
+	fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+	for (int idx = 0; idx < size1; ++idx) handleEvent(queue[start1 + idx]);
+	for (int idx = 0; idx < size2; ++idx) handleEvent(queue[start2 + idx]);
+	fifo.finishedRead(size1 + size2);
+}
+
+void Arpeggiator::handleEvent(const Event& event)
+{
+	if (event.type == Event::stopEvent) {
+		for (auto& voice : voices) {
+			voice.isPlaying = false;
+			voice.numHeldNotes = 0;
+			voice.numSteps = 0;
+			endAllNotes(voice, event.time);
+			updateDueTime(voice);
+		}
+		return;
+	}
+
+	Voice& voice = voices[event.slot];
+	int heldIdx = 0;
+	while (heldIdx < voice.numHeldNotes && voice.heldNotes[heldIdx] != event.noteNumber) ++heldIdx;
+
+	if (event.type == Event::noteOnEvent) {
+		if (!voice.isPlaying) {
+			// The first note starts the pattern right away (or on the next step of the clock grid),
+			// with the settings of its zone
+			voice.isPlaying = true;
+			voice.settings = event.settings;
+			voice.outChannel = event.outChannel;
+			voice.outPort = event.outPort;
+			voice.numHeldNotes = 0;
+			voice.stepIdx = 0;
+			const double stepLength = getStepLength(voice.settings);
+			if (!alignToClock(voice, event.time, stepLength)) {
+				voice.stepNumber = 0;
+				voice.gridTime = event.time;
+			}
+			setNextStepTime(voice, stepLength);
+			heldIdx = 0;
+		}
+		if (heldIdx == voice.numHeldNotes) voice.heldNotes[voice.numHeldNotes++] = (uint8)event.noteNumber;
+		voice.velocities[event.noteNumber] = event.velocity;
+	}
+	else {
+		if (heldIdx == voice.numHeldNotes) return;
+		for (int idx = heldIdx + 1; idx < voice.numHeldNotes; ++idx) voice.heldNotes[idx - 1] = voice.heldNotes[idx];
+		--voice.numHeldNotes;
+		// The sounding notes end at the end of their gate
+		if (voice.numHeldNotes == 0) voice.isPlaying = false;
+	}
+	buildSteps(voice);
+	updateDueTime(voice);
+}
+
+void Arpeggiator::clockTick(double time)
+{
+	const double interval = time - lastClockTime.exchange(time);
+	if (interval > 0.0 && interval <= MAX_MIDI_CLOCK_INTERVAL) {
+		const double currentLength = beatLength.load();
+		beatLength.store(currentLength + (interval * MIDI_CLOCKS_PER_BEAT - currentLength) * MIDI_CLOCK_SMOOTHING);
+	}
+	if (!isSongPlaying.load()) return;
+	// The grid starts again on the first clock after Start or a Song Position Pointer, then on every whole note
+	const int64 clockNumber = nextClockNumber.fetch_add(1);
+	const int64 clocksIntoWholeNote = clockNumber % MIDI_CLOCKS_PER_WHOLE_NOTE;
+	if (clocksIntoWholeNote == 0 || gridStartTime.load() <= 0.0)
+		gridStartTime.store(time - clocksIntoWholeNote * beatLength.load() / MIDI_CLOCKS_PER_BEAT);
+}
+
+bool Arpeggiator::alignToClock(Voice& voice, double time, double stepLength)
+{
+	const double startTime = gridStartTime.load();
+	if (startTime <= 0.0) return false;
+	voice.stepNumber = (int64)std::ceil((time - startTime) / stepLength - ARPEGGIATOR_SYNC_TOLERANCE);
+	voice.gridTime = startTime + voice.stepNumber * stepLength;
+	return true;
+}
+
+// Odd steps are delayed by the swing
+void Arpeggiator::setNextStepTime(Voice& voice, double stepLength)
+{
+	voice.nextStepTime = voice.gridTime + ((voice.stepNumber & 1) != 0 ? voice.settings.swing * stepLength : 0.0);
+}
+
+void Arpeggiator::updateDueTime(Voice& voice)
+{
+	double dueTime = voice.isPlaying && voice.numSteps > 0 ? voice.nextStepTime : 0.0;
+	for (int idx = 0; idx < voice.numSoundingNotes; ++idx) {
+		const double noteOffTime = voice.noteOffTimes[voice.soundingNotes[idx]];
+		if (dueTime <= 0.0 || noteOffTime < dueTime) dueTime = noteOffTime;
+	}
+	voice.nextDueTime = dueTime;
+}
+
+void Arpeggiator::buildSteps(Voice& voice)
+{
+	const ArpeggiatorSettings& settings = voice.settings;
+	const int numNotes = voice.numHeldNotes;
+	std::copy(voice.heldNotes.begin(), voice.heldNotes.begin() + numNotes, sortedNotes.begin());
+	if (settings.mode != ArpeggiatorSettings::asPlayedMode) std::sort(sortedNotes.begin(), sortedNotes.begin() + numNotes);
+
+	// Going up through the octaves
+	voice.numSteps = 0;
+	for (int octave = 0; octave < settings.octaves; ++octave) {
+		for (int idx = 0; idx < numNotes; ++idx) {
+			const int noteNumber = sortedNotes[idx] + octave * 12;
+			if (noteNumber > MAX_NOTE_NUMBER) continue;
+			voice.steps[voice.numSteps] = (uint8)noteNumber;
+			voice.stepVelocities[voice.numSteps++] = voice.velocities[sortedNotes[idx]];
+		}
+	}
+	if (settings.mode == ArpeggiatorSettings::downMode) {
+		std::reverse(voice.steps.begin(), voice.steps.begin() + voice.numSteps);
+		std::reverse(voice.stepVelocities.begin(), voice.stepVelocities.begin() + voice.numSteps);
+	}
+	else if (settings.mode == ArpeggiatorSettings::upDownMode) {
+		// Back down without repeating the highest and the lowest step
+		const int numUpSteps = voice.numSteps;
+		for (int idx = numUpSteps - 2; idx > 0; --idx) {
+			voice.steps[voice.numSteps] = voice.steps[idx];
+			voice.stepVelocities[voice.numSteps++] = voice.stepVelocities[idx];
+		}
+	}
+	if (voice.numSteps > 0) voice.stepIdx %= voice.numSteps;
+	else voice.stepIdx = 0;
+}
+
+double Arpeggiator::playDueNotes(double now)
+{
+	double nextTime = 0.0;
+	for (auto& voice : voices) {
+		if (voice.nextDueTime <= 0.0) continue;
+		if (voice.nextDueTime <= now) {
+			// Note Offs first, so that a gate of 1 is legato
+			for (int idx = 0; idx < voice.numSoundingNotes;) {
+				const int noteNumber = voice.soundingNotes[idx];
+				const double noteOffTime = voice.noteOffTimes[noteNumber];
+				if (noteOffTime <= now) endNote(voice, noteNumber, noteOffTime);
+				else ++idx;
+			}
+			if (voice.isPlaying && voice.numSteps > 0 && voice.nextStepTime <= now) playStep(voice, now);
+			updateDueTime(voice);
+		}
+		if (voice.nextDueTime > 0.0 && (nextTime <= 0.0 || voice.nextDueTime < nextTime)) nextTime = voice.nextDueTime;
+	}
+	return nextTime;
+}
+
+void Arpeggiator::playStep(Voice& voice, double now)
+{
+	const ArpeggiatorSettings& settings = voice.settings;
+	const double stepLength = getStepLength(settings);
+	if (settings.mode == ArpeggiatorSettings::repeatMode) {
+		// Note repeat: all the held notes at every step
+		for (int idx = 0; idx < voice.numHeldNotes; ++idx) {
+			playNote(voice, voice.heldNotes[idx], voice.velocities[voice.heldNotes[idx]], stepLength);
+		}
+	}
+	else {
+		const int stepIdx = settings.mode == ArpeggiatorSettings::randomMode ? random.nextInt(voice.numSteps) : voice.stepIdx;
+		playNote(voice, voice.steps[stepIdx], voice.stepVelocities[stepIdx], stepLength);
+		voice.stepIdx = (voice.stepIdx + 1) % voice.numSteps;
+	}
+
+	const int64 lateness = (int64)((now - voice.nextStepTime) * 1000000.0);
+	numPlayedSteps.fetch_add(1, std::memory_order_relaxed);
+	totalLateness.fetch_add(lateness, std::memory_order_relaxed);
+	if (lateness > maxLateness.load(std::memory_order_relaxed)) maxLateness.store(lateness, std::memory_order_relaxed);
+
+	if (!alignToClock(voice, jmax(voice.gridTime + stepLength, now), stepLength)) {
+		++voice.stepNumber;
+		voice.gridTime += stepLength;
+		if (voice.gridTime < now - stepLength) voice.gridTime = now; // Too late (tempo change or stall): start again from now
+	}
+	setNextStepTime(voice, stepLength);
+}
+
+void Arpeggiator::playNote(Voice& voice, int noteNumber, uint8 velocity, double stepLength)
+{
+	if (velocity == 0) velocity = (uint8)MAX_VELOCITY;
+	// Retriggered before the end of its gate
+	if (voice.noteOffTimes[noteNumber] > 0.0) endNote(voice, noteNumber, voice.nextStepTime);
+	output.routeMidiMessage(MidiMessage(MidiMessage::noteOn(voice.outChannel, noteNumber, velocity), voice.nextStepTime), voice.outPort);
+	voice.noteOffTimes[noteNumber] = voice.nextStepTime + stepLength * voice.settings.gate;
+	int idx = voice.numSoundingNotes++;
+	for (; idx > 0 && voice.soundingNotes[idx - 1] > noteNumber; --idx) voice.soundingNotes[idx] = voice.soundingNotes[idx - 1];
+	voice.soundingNotes[idx] = (uint8)noteNumber;
+}
+
+void Arpeggiator::endNote(Voice& voice, int noteNumber, double time)
+{
+	output.routeMidiMessage(MidiMessage(MidiMessage::noteOff(voice.outChannel, noteNumber), time), voice.outPort);
+	voice.noteOffTimes[noteNumber] = 0.0;
+	for (int idx = 0; idx < voice.numSoundingNotes; ++idx) {
+		if (voice.soundingNotes[idx] != noteNumber) continue;
+		std::copy(voice.soundingNotes.begin() + idx + 1, voice.soundingNotes.begin() + voice.numSoundingNotes, voice.soundingNotes.begin() + idx);
+		--voice.numSoundingNotes;
+		break;
+	}
+}
+
+void Arpeggiator::endAllNotes(Voice& voice, double time)
+{
+	while (voice.numSoundingNotes > 0) endNote(voice, voice.soundingNotes[0], time);
+}
+
+double Arpeggiator::getStepLength(const ArpeggiatorSettings& settings)
+{
+	// A whole note is 4 beats
+	return beatLength.load() * 4.0 / settings.division;
+}
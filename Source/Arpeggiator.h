@@ -0,0 +1,171 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Setlist.h"
+#include "ZoneRouter.h"
+
+#define ARPEGGIATOR_QUEUE_SIZE 1024
+#define ARPEGGIATOR_THREAD_PRIORITY 9
+#define ARPEGGIATOR_IDLE_WAIT_MS 100
+// The thread sleeps until this long before the next note, then spins on the high-resolution clock
+#define ARPEGGIATOR_SPIN_TIME 0.002
+#define MAX_ARPEGGIATOR_STEPS (NUM_MIDI_NOTES * MAX_ARPEGGIATOR_OCTAVES * 2)
+
+#define DEFAULT_ARPEGGIATOR_TEMPO 120.0
+#define MIN_ARPEGGIATOR_TEMPO 20.0
+#define MAX_ARPEGGIATOR_TEMPO 300.0
+#define MIDI_CLOCKS_PER_BEAT 24
+// Clock ticks further apart than this (slower than 20 BPM) restart the tempo measure
+#define MAX_MIDI_CLOCK_INTERVAL 0.125
+// Weight of every new clock interval in the measured tempo
+#define MIDI_CLOCK_SMOOTHING 0.1
+#define MIDI_CLOCKS_PER_WHOLE_NOTE (MIDI_CLOCKS_PER_BEAT * 4)
+#define MIDI_CLOCKS_PER_SONG_POSITION 6
+// On the clock grid, a pattern started this late (in steps) still plays the step it missed
+#define ARPEGGIATOR_SYNC_TOLERANCE 0.25
+
+// Plays the arpeggiated zones of the current configuration on its own high-resolution thread.
+// The router hands over the notes through a queue and never waits; every slot has its held
+// notes and its pattern in buffers allocated once, so playing never allocates.
+// The tempo follows the MIDI clock of the inputs or the tempo detected on the audio input,
+// whichever was given last. Once a Start or a Song Position Pointer gives the position of the
+// clock, the steps fall on its grid; a Stop ends the patterns and the grid.
+// Without its own thread the arpeggiator is driven by advanceTo(), on the times it is given,
+// so that a recorded session can be replayed on its own clock.
+class Arpeggiator : public Thread
+{
+public:
+	// The routed notes go to output, from the arpeggiator thread (or from advanceTo())
+	Arpeggiator(ZoneRouter::Output& output, bool hasOwnThread = true);
+	~Arpeggiator();
+
+	void run() override;
+
+	// Called by the router from the MIDI threads; notes are already transposed
+	void noteOn(const Zone& zone, int noteNumber, uint8 velocity);
+	void noteOff(const Zone& zone, int noteNumber);
+	// Releases every held note and ends the sounding ones (when the configuration changes);
+	// the destructor ends them too
+	void stopAll();
+
+	// Without its own thread, from the thread that gives the notes: handles the notes given so
+	// far (at the previous time), plays every step due until time (in seconds) and returns the
+	// time of the next one, 0 if nothing is scheduled
+	double advanceTo(double time);
+
+	// MIDI clock (24 per beat), Start, Continue, Stop and Song Position Pointer messages,
+	// received at time, in seconds; the other messages are ignored
+	void handleSyncMessage(const MidiMessage& message, double time);
+	void setTempo(double beatsPerMinute);
+	double getTempo();
+
+	// How late the steps were played, measured by the thread itself
+	int64 getNumPlayedSteps();
+	double getMeanLateness();
+	double getMaxLateness();
+	void resetTimingStats();
+
+	// The clock of the schedule and of the time stamps of the routed messages, in seconds
+	// (the same as the time stamps of the MIDI inputs)
+	static double getCurrentTime();
+
+private:
+	struct Event
+	{
+		enum Type { noteOnEvent, noteOffEvent, stopEvent };
+
+		int type;
+		int slot;
+		int noteNumber;
+		uint8 velocity;
+		int outChannel;
+		int outPort;
+		ArpeggiatorSettings settings;
+		double time;
+	};
+
+	struct Voice
+	{
+		bool isPlaying = false;
+		ArpeggiatorSettings settings;
+		int outChannel = DEFAULT_OUT_CHANNEL;
+		int outPort = DEFAULT_OUTPUT_PORT;
+
+		// Held notes, in the order they were played, with their velocities
+		std::array<uint8, NUM_MIDI_NOTES> heldNotes;
+		int numHeldNotes = 0;
+		std::array<uint8, NUM_MIDI_NOTES> velocities;
+
+		// One cycle of the pattern with the velocities of its notes, rebuilt when the held notes change
+		std::array<uint8, MAX_ARPEGGIATOR_STEPS> steps;
+		std::array<uint8, MAX_ARPEGGIATOR_STEPS> stepVelocities;
+		int numSteps = 0;
+		int stepIdx = 0;
+
+		// Time of the next step without swing, its number and its actual time
+		double gridTime = 0.0;
+		int64 stepNumber = 0;
+		double nextStepTime = 0.0;
+
+		// When every sounding note ends, 0 if it is not sounding
+		std::array<double, NUM_MIDI_NOTES> noteOffTimes;
+		// The sounding notes, in ascending order
+		std::array<uint8, NUM_MIDI_NOTES> soundingNotes;
+		int numSoundingNotes = 0;
+
+		// The earliest of the next step and of the Note Offs, 0 if nothing is scheduled
+		double nextDueTime = 0.0;
+	};
+
+	// The time of the notes given now
+	double getEventTime();
+	void pushEvent(const Event& event);
+	void readEvents();
+	void handleEvent(const Event& event);
+	void buildSteps(Voice& voice);
+	void clockTick(double time);
+	// Places the next step of the voice on the clock grid, at the first step from time;
+	// false when the position of the clock is unknown
+	bool alignToClock(Voice& voice, double time, double stepLength);
+	void setNextStepTime(Voice& voice, double stepLength);
+	void updateDueTime(Voice& voice);
+	// Plays what is due and returns the time of the next note, 0 if nothing is scheduled
+	double playDueNotes(double now);
+	void playStep(Voice& voice, double now);
+	void playNote(Voice& voice, int noteNumber, uint8 velocity, double stepLength);
+	void endNote(Voice& voice, int noteNumber, double time);
+	void endAllNotes(Voice& voice, double time);
+	double getStepLength(const ArpeggiatorSettings& settings);
+
+	ZoneRouter::Output& output;
+	const bool hasOwnThread;
+	// Without its own thread, the time of the last advanceTo() (read by stopAll() from any thread)
+	std::atomic<double> clockTime { 0.0 };
+
+	// Event queue (multiple producers, the arpeggiator thread is the only consumer)
+	AbstractFifo fifo;
+	std::vector<Event> queue;
+	SpinLock writeLock;
+	WaitableEvent eventsAvailable;
+
+	// Only touched by the arpeggiator thread
+	std::vector<Voice> voices;
+	std::array<uint8, NUM_MIDI_NOTES> sortedNotes;
+	Random random;
+
+	// Tempo
+	std::atomic<double> beatLength { 60.0 / DEFAULT_ARPEGGIATOR_TEMPO };
+	std::atomic<double> lastClockTime { 0.0 };
+	// Between Start (or Continue) and Stop, the clocks count from the start of the song
+	std::atomic<bool> isSongPlaying { false };
+	std::atomic<int64> nextClockNumber { 0 };
+	// Time of the start of a whole note on the clock grid, 0 without one
+	std::atomic<double> gridStartTime { 0.0 };
+
+	// Timing (microseconds)
+	std::atomic<int64> numPlayedSteps { 0 };
+	std::atomic<int64> totalLateness { 0 };
+	std::atomic<int64> maxLateness { 0 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Arpeggiator)
+};
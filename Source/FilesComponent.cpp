@@ -1,7 +1,7 @@
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "FilesComponent.h"
 
-FilesComponent::FilesComponent()
+FilesComponent::FilesComponent(Setlist& setlist) : setlist(setlist)
 {
 	// MIDI Zones Management
 	addAndMakeVisible(directoryOpenButton);
@@ -16,7 +16,7 @@ FilesComponent::FilesComponent()
 	addAndMakeVisible(currentFileNameTextEditor);
 	currentFileNameTextEditor.setReadOnly(true);
 	currentFileNameTextEditor.setFont(Font(FONT_SIZE, 0));
-	printOnCurrentFileTextEditor("No file loaded...");
+	updateCurrentFileName();
 
 	// CC Management
 	addAndMakeVisible(ccMappingFileOpenButton);
@@ -43,124 +43,65 @@ void FilesComponent::resized()
 	ccMappingFileOpenButton.setBounds(		EXT_MARGIN,						getHeight() - BUTTON_HEIGHT - EXT_MARGIN,			getWidth() - EXT_MARGIN * 2,					BUTTON_HEIGHT);
 }
 
-std::vector<json> FilesComponent::getProgramChangesList() {
-	return this->localProgramChangesList;
-}
-
-std::vector<json> FilesComponent::getBankSelectList()
-{
-	return localBankSelectList;
-}
-
-std::vector<std::map<uint8_t, json>> FilesComponent::getSetlist() {
-	return this->localSetlist;
-}
-
-std::map<int, std::vector<int>> FilesComponent::getCCMapping() {
-	return this->localCCMapping;
+int FilesComponent::getCurrentFileIdx() {
+	return setlist.getCurrentFileIdx();
 }
 
-std::map<int, std::vector<int>> FilesComponent::getCCMappingChannels() {
-	return this->localCCMappingChannels;
+void FilesComponent::updateCurrentFileName() {
+	printOnCurrentFileTextEditor(setlist.getCurrentFileDescription());
 }
 
-int FilesComponent::getCurrentFileIdx() {
-	return this->localCurrentFileIdx;
+void FilesComponent::updateKeyboardName() {
+	keyboardName.setText(setlist.getCCMapping().keyboardName, dontSendNotification);
 }
 
 void FilesComponent::openDirectory() {
 	FileChooser fileChooser("Select the folder containing your setlist...",
 		File::getSpecialLocation(File::userDesktopDirectory));
 	if (fileChooser.browseForDirectory()) {
-		File folder = fileChooser.getResult();
-		DirectoryIterator iter(folder, false, "*.json", File::findFiles);
-		localSetlist.clear();
-		localSetlistNames.clear();
-		while (iter.next()) {
-			json file_content = readFile(iter.getFile());
-			addToSetlist(file_content["zones"]);
-			localProgramChangesList.push_back(file_content["programChanges"]);
-			localBankSelectList.push_back(file_content["bankSelects"]);
-			localSetlistNames.push_back(iter.getFile().getFileNameWithoutExtension());
-		}
-		localCurrentFileIdx = 0;
-		localCurrentZones = localSetlist[0];
-		char s[50];
-		sprintf(s, "[%d/%d] %s", localCurrentFileIdx + 1, localSetlistNames.size(), localSetlistNames[localCurrentFileIdx]);
-		printOnCurrentFileTextEditor(s);
+		const bool isLoaded = setlist.loadDirectory(fileChooser.getResult());
+		showLoadErrors();
+		if (!isLoaded) return;
+		updateCurrentFileName();
 		this->sendActionMessage("openDirectory");
 	}
 }
 
-void FilesComponent::addToSetlist(json fileContent) {
-	std::map<uint8_t, json> newZones;
-	for (auto input : fileContent) {
-		int inChannel = (int)input["inChannel"];
-		json zones = input["zones"];
-		newZones[inChannel] = zones;
-	}
-	localSetlist.push_back(newZones);
-}
-
-json FilesComponent::readFile(const File & fileToRead) {
-	if (!fileToRead.existsAsFile()) return nullptr;
-	FileInputStream inputStream(fileToRead);
-	if (!inputStream.openedOk()) return nullptr;
-	return json::parse(inputStream.readEntireStreamAsString().toStdString());
-}
-
 void FilesComponent::openCCMappingFile() {
 	FileChooser fileChooser("Select the file containing the CC mapping...",
 		File::getSpecialLocation(File::userDesktopDirectory),
 		"*.json");
 	if (fileChooser.browseForFileToOpen()) {
-		File ccMappingFile(fileChooser.getResult());
-		json newMapping = readCCMappingFile(ccMappingFile);
-		loadCCMapping(newMapping);
+		const bool isLoaded = setlist.loadCCMappingFile(fileChooser.getResult());
+		showLoadErrors();
+		if (!isLoaded) return;
+		updateKeyboardName();
+		this->sendActionMessage("loadCCMapping");
 	}
 }
 
-json FilesComponent::readCCMappingFile(File & fileToRead) {
-	if (!fileToRead.existsAsFile()) return nullptr;
-	FileInputStream inputStream(fileToRead);
-	if (!inputStream.openedOk()) return nullptr;
-	return json::parse(inputStream.readEntireStreamAsString().toStdString());
-}
-
-void FilesComponent::loadCCMapping(json newMapping) {
-	localCCMapping.clear();
-	localCCMappingChannels.clear();
-	keyboardName.setText(newMapping["keyboardName"].get<std::string>(), dontSendNotification);
-	auto mapping = newMapping["ccMapping"];
-	for (auto entry : mapping) {
-		if (localCCMapping.find(entry["CConKey"]) == localCCMapping.end()) {
-			localCCMapping[entry["CConKey"]] = std::vector<int>();
-			localCCMappingChannels[entry["CConKey"]] = std::vector<int>();
-		}
-		localCCMapping[entry["CConKey"]].push_back(entry["CConVST"]);
-		localCCMappingChannels[entry["CConKey"]].push_back(entry["outChannel"]);
-	}
-	this->sendActionMessage("loadCCMapping");
+void FilesComponent::showLoadErrors() {
+	if (setlist.getLoadErrors().isEmpty()) return;
+	AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Some files could not be loaded",
+		setlist.getLoadErrors().joinIntoString(newLine));
 }
 
 void FilesComponent::loadPreviousFile() {
-	if (localCurrentFileIdx <= 0) return;
-	localCurrentFileIdx = localCurrentFileIdx - 1;
-	localCurrentZones = localSetlist[localCurrentFileIdx];
+	if (!setlist.selectPreviousFile()) return;
 	this->sendActionMessage("loadPreviousFile");
-	char s[50];
-	sprintf(s, "[%d/%d] %s", localCurrentFileIdx + 1, localSetlistNames.size(), localSetlistNames[localCurrentFileIdx]);
-	printOnCurrentFileTextEditor(s);
+	updateCurrentFileName();
 }
 
 void FilesComponent::loadNextFile() {
-	if (localCurrentFileIdx >= localSetlist.size() - 1) return;
-	localCurrentFileIdx = localCurrentFileIdx + 1;
-	localCurrentZones = localSetlist[localCurrentFileIdx];
+	if (!setlist.selectNextFile()) return;
 	this->sendActionMessage("loadNextFile");
-	char s[50];
-	sprintf(s, "[%d/%d] %s", localCurrentFileIdx + 1, localSetlistNames.size(), localSetlistNames[localCurrentFileIdx]);
-	printOnCurrentFileTextEditor(s);
+	updateCurrentFileName();
+}
+
+void FilesComponent::loadFile(int fileIdx) {
+	if (!setlist.selectFile(fileIdx)) return;
+	this->sendActionMessage("loadFile");
+	updateCurrentFileName();
 }
 
 void FilesComponent::addListener(ActionListener * listener)
@@ -1,7 +1,7 @@
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
-#include "../ExternalLib/json.hpp"
+#include <JuceHeader.h>
+#include "Setlist.h"
 
 // GUI Constants
 #define EXT_MARGIN 10
@@ -9,12 +9,10 @@
 #define BUTTON_HEIGHT 20
 #define FONT_SIZE 35
 
-using json = nlohmann::json;
-
 class FilesComponent    : public Component, ActionBroadcaster
 {
 public:
-    FilesComponent();
+    FilesComponent(Setlist& setlist);
     ~FilesComponent();
 
     void paint (Graphics&) override;
@@ -26,40 +24,28 @@ public:
 
 	void loadPreviousFile();
 	void loadNextFile();
+	void loadFile(int fileIdx);
 
-	std::vector<json> getProgramChangesList();
-	std::vector<json> getBankSelectList();
-	std::vector<std::map<uint8_t, json>> getSetlist();
-	std::map<int, std::vector<int>> getCCMapping();
-	std::map<int, std::vector<int>> getCCMappingChannels();
 	int getCurrentFileIdx();
+	void updateCurrentFileName();
+	void updateKeyboardName();
 private:
 	void openDirectory();
-	void addToSetlist(json fileContent);
-	json readFile(const File & fileToRead);
 	void openCCMappingFile();
-	json readCCMappingFile(File & fileToRead);
-	void loadCCMapping(json newMapping);
+	void showLoadErrors();
 	void printOnCurrentFileTextEditor(const String& m);
 
+	Setlist& setlist;
+
 	// Zone File Management
 	TextButton directoryOpenButton;
 	TextButton previousFileButton;
 	TextButton nextFileButton;
 	TextEditor currentFileNameTextEditor;
 
-	std::map<uint8_t, json> localCurrentZones;
-	std::vector<std::map<uint8_t, json>> localSetlist;
-	std::vector<String> localSetlistNames;
-	std::vector<json> localProgramChangesList;
-	std::vector<json> localBankSelectList;
-	int localCurrentFileIdx;
-
 	// CC Management
 	Label keyboardName;
 	TextButton ccMappingFileOpenButton;
-	std::map<int, std::vector<int>> localCCMapping;
-	std::map<int, std::vector<int>> localCCMappingChannels;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilesComponent)
 };
@@ -1,43 +1,30 @@
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
 #include "IOComponent.h"
 
-IOComponent::IOComponent()
+IOComponent::IOComponent(MidiBackend& b, MidiDeviceWatcher& w) : backend(b), watcher(w)
 {
-	// MIDI In
+	// MIDI In (the buttons are added as soon as the watcher has found the devices)
 	addAndMakeVisible(midiInputsLabel);
 	midiInputsLabel.setText("Active MIDI Inputs:", dontSendNotification);
-	midiInputsNames = MidiInput::getDevices();
-	midiInputButtons = OwnedArray<ToggleButton>();
-	for (auto in : midiInputsNames) {
-		auto newButton = new ToggleButton(in);
-		addAndMakeVisible(newButton);
-		midiInputButtons.add(newButton);
-		newButton->onClick = [this, newButton] { updateToggleState(newButton); };
-	}
 
 	// MIDI Out
+	addMidiOutputPort(new MidiOutputSender(backend));
 	addAndMakeVisible(midiOutputListLabel);
 	midiOutputListLabel.setText("MIDI Output:", dontSendNotification);
 	
 	addAndMakeVisible(midiOutputList);
 	midiOutputList.setTextWhenNoChoicesAvailable("No MIDI Outputs Enabled");
-	auto midiOutputs = MidiOutput::getDevices();
-	midiOutputList.addItemList(midiOutputs, 1);
 	midiOutputList.onChange = [this] { setMidiOutput(midiOutputList.getSelectedItemIndex()); };
 
-	for (auto midiOutput : midiOutputs) {
-		if (setMidiOutput(midiOutputs.indexOf(midiOutput)) != NULL) {
-			break;
-		}
-	}
-	// if no enabled devices were found just use the first one in the list
-	if (midiOutputList.getSelectedId() == 0)
-		setMidiOutput(0);
-
+	// The first scan may be over already, its message was then sent before this listener was added
+	watcher.addActionListener(this);
+	updateMidiInputs();
+	updateMidiOutputs();
 }
 
 IOComponent::~IOComponent()
 {
+	watcher.removeActionListener(this);
 	for (auto button : midiInputButtons) {
 		if (button->getToggleState()) removeMidiInput(button->getButtonText());
 	}
@@ -65,8 +52,6 @@ void IOComponent::updateToggleState(ToggleButton* button) {
 }
 
 void IOComponent::addMidiInput(String name) {
-	if (!deviceManager->isMidiInputEnabled(name))
-		deviceManager->setMidiInputEnabled(name, true);
 	this->sendActionMessage("A" + name);
 }
 
@@ -74,31 +59,145 @@ void IOComponent::removeMidiInput(String name) {
 	this->sendActionMessage("D" + name);
 }
 
-bool IOComponent::setMidiOutput(int index) {
-	midiOutputDevice.reset(MidiOutput::openDevice(index));
+void IOComponent::setMidiOutput(int index) {
+	if (index < 0 || index >= midiOutputNames.size()) return;
 	midiOutputList.setSelectedId(index + 1, dontSendNotification);
 	lastOutputIndex = index;
-	return midiOutputDevice != nullptr;
+	// The port names only change with the device of the default port
+	if (midiOutputSenders[DEFAULT_OUTPUT_PORT]->getDeviceName() == midiOutputNames[index]) return;
+	// Opened by the sender thread when the first message comes
+	midiOutputSenders[DEFAULT_OUTPUT_PORT]->setDevice(midiOutputNames[index]);
+	this->sendActionMessage("outputsChanged");
+}
+
+int IOComponent::getMidiOutputPort(const String& deviceName) {
+	if (deviceName.isEmpty()) return DEFAULT_OUTPUT_PORT;
+	for (int port = 0; port < midiOutputSenders.size(); ++port) {
+		if (midiOutputSenders[port]->getDeviceName() == deviceName) return port;
+	}
+	// Add a new port. The device is opened by the sender at its first message. A device that
+	// is not connected still gets its port, its messages are dropped until it is plugged in.
+	if (midiOutputSenders.size() >= MAX_OUTPUT_PORTS) return DEFAULT_OUTPUT_PORT;
+	const int port = addMidiOutputPort(new MidiOutputSender(backend, deviceName));
+	this->sendActionMessage("outputsChanged");
+	return port;
+}
+
+int IOComponent::addMidiOutputPort(MidiOutputSender* sender) {
+	const int port = midiOutputSenders.size();
+	midiOutputSenders.add(sender);
+	outputPorts[port] = sender;
+	numOutputPorts.store(port + 1, std::memory_order_release);
+	return port;
+}
+
+StringArray IOComponent::getMidiOutputPortNames() {
+	StringArray names;
+	for (auto sender : midiOutputSenders) {
+		names.add(sender->getDeviceName());
+	}
+	return names;
+}
+
+int IOComponent::getNumOutputPorts() {
+	return numOutputPorts.load(std::memory_order_acquire);
+}
+
+MidiOutputSender* IOComponent::getOutputSender(int port) {
+	if (port < 0 || port >= getNumOutputPorts()) return nullptr;
+	return outputPorts[port];
+}
+
+bool IOComponent::sendMIDIMessage(const MidiMessage& message) {
+	return sendMIDIMessage(message, DEFAULT_OUTPUT_PORT);
 }
 
-void IOComponent::sendMIDIMessage(const MidiMessage& message) {
-	midiOutputDevice->sendMessageNow(message);
+bool IOComponent::sendMIDIMessage(const MidiMessage& message, int port) {
+	if (port < 0 || port >= numOutputPorts.load(std::memory_order_acquire)) port = DEFAULT_OUTPUT_PORT;
+	return outputPorts[port]->enqueueMessage(message);
 }
 
 void IOComponent::sendMIDIClockBeat()
 {
+	// Called from the audio thread
 	MidiMessage clock = MidiMessage::midiClock();
-	for (unsigned int i = 0; i < 24; ++i) {
-		midiOutputDevice->sendMessageNow(clock);
+	const int numPorts = numOutputPorts.load(std::memory_order_acquire);
+	for (int port = 0; port < numPorts; ++port) {
+		for (unsigned int i = 0; i < 24; ++i) {
+			outputPorts[port]->enqueueMessage(clock);
+		}
 	}
 }
 
 void IOComponent::sendNoteOffToAll()
 {
-	for (unsigned int chIdx = 1; chIdx <= 16; ++chIdx) {
-		MidiMessage allNoteOff = MidiMessage::allNotesOff(chIdx);
-		midiOutputDevice->sendMessageNow(allNoteOff);
+	for (auto sender : midiOutputSenders) {
+		for (unsigned int chIdx = 1; chIdx <= 16; ++chIdx) {
+			MidiMessage allNoteOff = MidiMessage::allNotesOff(chIdx);
+			sender->enqueueMessage(allNoteOff);
+		}
+	}
+}
+
+void IOComponent::actionListenerCallback(const String& message)
+{
+	if (message.compare("devicesChanged") == 0) {
+		updateMidiInputs();
+		updateMidiOutputs();
+	}
+}
+
+void IOComponent::updateMidiInputs()
+{
+	const StringArray connectedNames = watcher.getInputDevices();
+	midiInputsNames = connectedNames;
+	for (auto button : midiInputButtons) {
+		if (button->getToggleState()) midiInputsNames.addIfNotAlreadyThere(button->getButtonText());
+	}
+
+	// The existing buttons are kept, with their state; the ones of removed devices are deleted with the old array
+	OwnedArray<ToggleButton> newButtons;
+	for (auto name : midiInputsNames) {
+		ToggleButton* button = nullptr;
+		for (int idx = 0; idx < midiInputButtons.size(); ++idx) {
+			if (midiInputButtons[idx]->getButtonText() == name) {
+				button = midiInputButtons.removeAndReturn(idx);
+				break;
+			}
+		}
+		if (button == nullptr) {
+			button = new ToggleButton(name);
+			addAndMakeVisible(button);
+			button->onClick = [this, button] { updateToggleState(button); };
+		}
+		button->setColour(ToggleButton::textColourId, connectedNames.contains(name) ? findColour(Label::textColourId) : Colours::grey);
+		newButtons.add(button);
+	}
+	midiInputButtons.swapWith(newButtons);
+	resized();
+}
+
+void IOComponent::updateMidiOutputs()
+{
+	const StringArray connectedNames = watcher.getOutputDevices();
+	// Ports whose device came back try to open it again, the ones whose device went away close it
+	for (auto sender : midiOutputSenders) {
+		const String name = sender->getDeviceName();
+		if (name.isEmpty()) continue;
+		const bool wasConnected = midiOutputNames.contains(name);
+		const bool isConnected = connectedNames.contains(name);
+		if (isConnected && !wasConnected) sender->deviceConnected();
+		else if (!isConnected && wasConnected) sender->deviceDisconnected();
 	}
+
+	midiOutputNames = connectedNames;
+	midiOutputList.clear(dontSendNotification);
+	midiOutputList.addItemList(midiOutputNames, 1);
+	// The selected device is remembered while it is unplugged
+	const String selectedName = midiOutputSenders[DEFAULT_OUTPUT_PORT]->getDeviceName();
+	if (selectedName.isEmpty()) setMidiOutput(0);
+	else if (midiOutputNames.contains(selectedName)) midiOutputList.setSelectedId(midiOutputNames.indexOf(selectedName) + 1, dontSendNotification);
+	else midiOutputList.setText(selectedName + " (disconnected)", dontSendNotification);
 }
 
 void IOComponent::addListener(ActionListener * listener)
@@ -116,7 +215,3 @@ void IOComponent::removeAllListeners()
 	this->removeAllActionListeners();
 }
 
-void IOComponent::setDeviceManager(AudioDeviceManager * deviceManager)
-{
-	this->deviceManager = deviceManager;
-}
@@ -1,16 +1,23 @@
 #pragma once
 
-#include "../JuceLibraryCode/JuceHeader.h"
+#include <JuceHeader.h>
+#include "MidiBackend.h"
+#include "MidiOutputSender.h"
+#include "MidiDeviceWatcher.h"
 
 // GUI Constants
 #define EXT_MARGIN 10
 #define INT_MARGIN 4
 #define BUTTON_HEIGHT 20
 
-class IOComponent    : public Component, ActionBroadcaster
+// MIDI Output Ports
+#define DEFAULT_OUTPUT_PORT 0
+#define MAX_OUTPUT_PORTS 32
+
+class IOComponent    : public Component, ActionBroadcaster, private ActionListener
 {
 public:
-    IOComponent();
+    IOComponent(MidiBackend& backend, MidiDeviceWatcher& watcher);
     ~IOComponent();
 
     void paint (Graphics&) override;
@@ -22,27 +29,45 @@ public:
 
 	void removeMidiInput(String name);
 
-	bool setMidiOutput(int index);
+	void setMidiOutput(int index);
+	int getMidiOutputPort(const String& deviceName);
+	StringArray getMidiOutputPortNames();
+	int getNumOutputPorts();
+	// For the tools, which look at the queues; nullptr for a port that does not exist
+	MidiOutputSender* getOutputSender(int port);
 
-	void sendMIDIMessage(const MidiMessage& message);
+	bool sendMIDIMessage(const MidiMessage& message);
+	// Returns false if the message was dropped because the port queue is full
+	bool sendMIDIMessage(const MidiMessage& message, int port);
 	void sendMIDIClockBeat();
 	void sendNoteOffToAll();
 
 	void addListener(ActionListener* listener);
 	void removeListener(ActionListener* listener);
 	void removeAllListeners();
-	
-	void setDeviceManager(AudioDeviceManager* deviceManager);
 
 private:
-	// MIDI Input
-	AudioDeviceManager* deviceManager;
+	// Rebuilds the lists when the watcher announces "devicesChanged"
+	void actionListenerCallback(const String& message) override;
+	void updateMidiInputs();
+	void updateMidiOutputs();
+	int addMidiOutputPort(MidiOutputSender* sender);
+
+	MidiBackend& backend;
+	MidiDeviceWatcher& watcher;
+
+	// MIDI Input (an enabled device that is unplugged keeps its button, greyed out)
 	Label midiInputsLabel;
 	StringArray midiInputsNames;
 	OwnedArray<ToggleButton> midiInputButtons;
 
-	// MIDI Output
-	std::unique_ptr<MidiOutput> midiOutputDevice;
+	// MIDI Output (port 0 is the one selected in the list, the others are opened by name).
+	// The senders are owned and added by the message thread; the other threads read the ports
+	// up to numOutputPorts, which is stored after the port it publishes.
+	OwnedArray<MidiOutputSender> midiOutputSenders;
+	MidiOutputSender* outputPorts[MAX_OUTPUT_PORTS] {};
+	std::atomic<int> numOutputPorts { 0 };
+	StringArray midiOutputNames;
 	ComboBox midiOutputList;
 	Label midiOutputListLabel;
 	int lastOutputIndex = 0;
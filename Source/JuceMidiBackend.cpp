@@ -0,0 +1,125 @@
+#include <JuceHeader.h>
+#include "JuceMidiBackend.h"
+#if JUCE_WINDOWS
+ #include <Windows.h>
+ #include <cfgmgr32.h>
+ #pragma comment(lib, "cfgmgr32.lib")
+#endif
+
+#if JUCE_WINDOWS
+// The interfaces of every device class: the MIDI drivers do not all register the audio one.
+// The callback is called on a thread of the system.
+struct JuceMidiBackend::SystemNotifications
+{
+	SystemNotifications(JuceMidiBackend& o) : owner(o)
+	{
+		CM_NOTIFY_FILTER filter = {};
+		filter.cbSize = sizeof(filter);
+		filter.Flags = CM_NOTIFY_FILTER_FLAG_ALL_INTERFACE_CLASSES;
+		filter.FilterType = CM_NOTIFY_FILTER_TYPE_DEVICEINTERFACE;
+		if (CM_Register_Notification(&filter, this, deviceInterfaceChanged, &notification) != CR_SUCCESS) notification = nullptr;
+	}
+
+	// Returns once the running callbacks are done
+	~SystemNotifications()
+	{
+		if (notification != nullptr) CM_Unregister_Notification(notification);
+	}
+
+	static DWORD CALLBACK deviceInterfaceChanged(HCMNOTIFICATION, PVOID context, CM_NOTIFY_ACTION action, PCM_NOTIFY_EVENT_DATA, DWORD)
+	{
+		auto notifications = static_cast<SystemNotifications*>(context);
+		if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEARRIVAL) notifications->owner.notifyDevicesChanged(false);
+		else if (action == CM_NOTIFY_ACTION_DEVICEINTERFACEREMOVAL) notifications->owner.notifyDevicesChanged(true);
+		return ERROR_SUCCESS;
+	}
+
+	JuceMidiBackend& owner;
+	HCMNOTIFICATION notification = nullptr;
+};
+#else
+// The devices are only scanned
+struct JuceMidiBackend::SystemNotifications
+{
+	SystemNotifications(JuceMidiBackend&) {}
+};
+#endif
+
+JuceMidiBackend::JuceMidiBackend(bool virtualPorts) : useVirtualPorts(virtualPorts)
+{
+}
+
+JuceMidiBackend::~JuceMidiBackend()
+{
+	const ScopedLock sl(inputsLock);
+	for (auto input : inputs) input->stop();
+}
+
+StringArray JuceMidiBackend::getInputDevices()
+{
+	return MidiInput::getDevices();
+}
+
+StringArray JuceMidiBackend::getOutputDevices()
+{
+	return MidiOutput::getDevices();
+}
+
+bool JuceMidiBackend::openInput(const String& name, MidiInputCallback* callback)
+{
+	std::unique_ptr<MidiInput> input;
+	if (useVirtualPorts) input.reset(MidiInput::createNewDevice(name, callback));
+	else {
+		int index = MidiInput::getDevices().indexOf(name);
+		if (index >= 0) input.reset(MidiInput::openDevice(index, callback));
+	}
+	if (input == nullptr) return false;
+	input->start();
+	const ScopedLock sl(inputsLock);
+	inputs.add(input.release());
+	inputNames.add(name);
+	return true;
+}
+
+void JuceMidiBackend::closeInput(const String& name)
+{
+	std::unique_ptr<MidiInput> input;
+	{
+		const ScopedLock sl(inputsLock);
+		int idx = inputNames.indexOf(name);
+		if (idx < 0) return;
+		input.reset(inputs.removeAndReturn(idx));
+		inputNames.remove(idx);
+	}
+	// After stop() the callback is not called anymore
+	input->stop();
+}
+
+std::unique_ptr<MidiBackend::Output> JuceMidiBackend::openOutput(const String& name)
+{
+	MidiOutput* device = nullptr;
+	if (useVirtualPorts) device = MidiOutput::createNewDevice(name);
+	else {
+		int index = MidiOutput::getDevices().indexOf(name);
+		if (index >= 0) device = MidiOutput::openDevice(index);
+	}
+	if (device == nullptr) return nullptr;
+	return std::unique_ptr<Output>(new DeviceOutput(device));
+}
+
+void JuceMidiBackend::setDeviceListener(DeviceListener* listener)
+{
+	{
+		const ScopedLock sl(listenerLock);
+		deviceListener = listener;
+	}
+	// The virtual ports are created by the application itself
+	if (listener != nullptr && systemNotifications == nullptr && !useVirtualPorts)
+		systemNotifications.reset(new SystemNotifications(*this));
+}
+
+void JuceMidiBackend::notifyDevicesChanged(bool hasRemovedDevice)
+{
+	const ScopedLock sl(listenerLock);
+	if (deviceListener != nullptr) deviceListener->devicesChanged(hasRemovedDevice);
+}
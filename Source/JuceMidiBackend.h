@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiBackend.h"
+
+// The MIDI devices of the system, through the JUCE MidiInput and MidiOutput classes.
+// With virtual ports (ALSA on Linux, CoreMIDI on macOS) every opened device is created
+// by the application with the requested name, for other programs to connect to.
+// On Windows the device listener is told about the devices plugged and unplugged.
+class JuceMidiBackend : public MidiBackend
+{
+public:
+	JuceMidiBackend(bool useVirtualPorts = false);
+	~JuceMidiBackend();
+
+	StringArray getInputDevices() override;
+	StringArray getOutputDevices() override;
+
+	bool openInput(const String& name, MidiInputCallback* callback) override;
+	void closeInput(const String& name) override;
+
+	std::unique_ptr<Output> openOutput(const String& name) override;
+
+	void setDeviceListener(DeviceListener* listener) override;
+
+private:
+	class DeviceOutput : public Output
+	{
+	public:
+		DeviceOutput(MidiOutput* d)
+			: device(d)
+		{}
+
+		void sendMessageNow(const MidiMessage& message) override { device->sendMessageNow(message); }
+
+		std::unique_ptr<MidiOutput> device;
+	};
+
+	// The device notifications of the system, registered with the first listener
+	struct SystemNotifications;
+
+	void notifyDevicesChanged(bool hasRemovedDevice);
+
+	const bool useVirtualPorts;
+
+	CriticalSection inputsLock;
+	OwnedArray<MidiInput> inputs;
+	StringArray inputNames;
+
+	// Held while the listener is told, so that it is never called after setDeviceListener(nullptr)
+	CriticalSection listenerLock;
+	DeviceListener* deviceListener = nullptr;
+	std::unique_ptr<SystemNotifications> systemNotifications;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JuceMidiBackend)
+};
@@ -0,0 +1,128 @@
+#include <JuceHeader.h>
+#include "LoopbackMidiBackend.h"
+
+LoopbackMidiBackend::LoopbackMidiBackend(int captureCapacity) : capturedEvents((size_t)jmax(1, captureCapacity))
+{
+}
+
+LoopbackMidiBackend::~LoopbackMidiBackend()
+{
+}
+
+void LoopbackMidiBackend::addInputDevice(const String& name)
+{
+	const ScopedLock sl(devicesLock);
+	if (inputDevices.contains(name)) return;
+	inputDevices.add(name);
+	inputCallbacks.add(nullptr);
+	if (deviceListener != nullptr) deviceListener->devicesChanged(false);
+}
+
+void LoopbackMidiBackend::addOutputDevice(const String& name)
+{
+	const ScopedLock sl(devicesLock);
+	if (outputDevices.addIfNotAlreadyThere(name) && deviceListener != nullptr) deviceListener->devicesChanged(false);
+}
+
+StringArray LoopbackMidiBackend::getInputDevices()
+{
+	const ScopedLock sl(devicesLock);
+	return inputDevices;
+}
+
+StringArray LoopbackMidiBackend::getOutputDevices()
+{
+	const ScopedLock sl(devicesLock);
+	return outputDevices;
+}
+
+bool LoopbackMidiBackend::openInput(const String& name, MidiInputCallback* callback)
+{
+	const ScopedLock sl(devicesLock);
+	int idx = inputDevices.indexOf(name);
+	if (idx < 0) return false;
+	inputCallbacks.set(idx, callback);
+	return true;
+}
+
+void LoopbackMidiBackend::closeInput(const String& name)
+{
+	const ScopedLock sl(devicesLock);
+	int idx = inputDevices.indexOf(name);
+	if (idx >= 0) inputCallbacks.set(idx, nullptr);
+}
+
+std::unique_ptr<MidiBackend::Output> LoopbackMidiBackend::openOutput(const String& name)
+{
+	const ScopedLock sl(devicesLock);
+	int idx = outputDevices.indexOf(name);
+	if (idx < 0) return nullptr;
+	return std::unique_ptr<Output>(new LoopbackOutput(*this, idx));
+}
+
+void LoopbackMidiBackend::setDeviceListener(DeviceListener* listener)
+{
+	const ScopedLock sl(devicesLock);
+	deviceListener = listener;
+}
+
+bool LoopbackMidiBackend::injectMessage(const String& inputName, const MidiMessage& message)
+{
+	const ScopedLock sl(devicesLock);
+	int idx = inputDevices.indexOf(inputName);
+	if (idx < 0 || inputCallbacks[idx] == nullptr) return false;
+	inputCallbacks[idx]->handleIncomingMidiMessage(nullptr, MidiMessage(message, getCurrentTime()));
+	return true;
+}
+
+double LoopbackMidiBackend::getCurrentTime()
+{
+	// Same clock as the time stamps of the JUCE MIDI inputs
+	return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+void LoopbackMidiBackend::capture(const MidiMessage& message, int outputIdx)
+{
+	const double time = getCurrentTime();
+	const SpinLock::ScopedLockType sl(captureLock);
+	if (numCapturedEvents >= (int)capturedEvents.size()) {
+		++numLostCaptures;
+		return;
+	}
+	CapturedEvent& event = capturedEvents[(size_t)numCapturedEvents++];
+	event.message = message;
+	event.outputIdx = outputIdx;
+	event.time = time;
+}
+
+int LoopbackMidiBackend::getNumCapturedEvents()
+{
+	const SpinLock::ScopedLockType sl(captureLock);
+	return numCapturedEvents;
+}
+
+int LoopbackMidiBackend::getNumLostCaptures()
+{
+	const SpinLock::ScopedLockType sl(captureLock);
+	return numLostCaptures;
+}
+
+void LoopbackMidiBackend::getCapturedEvents(std::vector<CapturedEvent>& events)
+{
+	const SpinLock::ScopedLockType sl(captureLock);
+	events.assign(capturedEvents.begin(), capturedEvents.begin() + numCapturedEvents);
+}
+
+void LoopbackMidiBackend::takeCapturedEvents(std::vector<CapturedEvent>& events)
+{
+	const SpinLock::ScopedLockType sl(captureLock);
+	events.assign(capturedEvents.begin(), capturedEvents.begin() + numCapturedEvents);
+	numCapturedEvents = 0;
+}
+
+void LoopbackMidiBackend::clearCapturedEvents()
+{
+	const SpinLock::ScopedLockType sl(captureLock);
+	numCapturedEvents = 0;
+	numLostCaptures = 0;
+}
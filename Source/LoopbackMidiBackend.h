@@ -0,0 +1,84 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiBackend.h"
+
+#define DEFAULT_LOOPBACK_CAPTURE_SIZE (1 << 20)
+
+// In-process MIDI devices: messages are injected into the inputs by the caller, and
+// everything sent to the outputs is captured with its time. Used to exercise the whole
+// input to output path, and to measure its latency, on machines without MIDI interfaces.
+class LoopbackMidiBackend : public MidiBackend
+{
+public:
+	struct CapturedEvent
+	{
+		// The time stamp is the one of the injected message this one was routed from
+		MidiMessage message;
+		int outputIdx;
+		// When the output received it, in seconds (same clock as the time stamps)
+		double time;
+	};
+
+	LoopbackMidiBackend(int captureCapacity = DEFAULT_LOOPBACK_CAPTURE_SIZE);
+	~LoopbackMidiBackend();
+
+	void addInputDevice(const String& name);
+	void addOutputDevice(const String& name);
+
+	StringArray getInputDevices() override;
+	StringArray getOutputDevices() override;
+
+	bool openInput(const String& name, MidiInputCallback* callback) override;
+	void closeInput(const String& name) override;
+
+	std::unique_ptr<Output> openOutput(const String& name) override;
+
+	// Told about the added devices, which are found without waiting for a scan
+	void setDeviceListener(DeviceListener* listener) override;
+
+	// Delivers the message to the callback of an open input on the calling thread, as the
+	// MIDI thread of a driver would, with the current time as time stamp.
+	// Returns false if the input is not open.
+	bool injectMessage(const String& inputName, const MidiMessage& message);
+	// The clock of the time stamps, in seconds
+	static double getCurrentTime();
+
+	// The capture buffer is preallocated: events beyond its capacity are only counted
+	int getNumCapturedEvents();
+	int getNumLostCaptures();
+	void getCapturedEvents(std::vector<CapturedEvent>& events);
+	// Moves the captured events into events and empties the capture buffer
+	void takeCapturedEvents(std::vector<CapturedEvent>& events);
+	void clearCapturedEvents();
+
+private:
+	class LoopbackOutput : public Output
+	{
+	public:
+		LoopbackOutput(LoopbackMidiBackend& o, int i)
+			: owner(o), outputIdx(i)
+		{}
+
+		void sendMessageNow(const MidiMessage& message) override { owner.capture(message, outputIdx); }
+
+		LoopbackMidiBackend& owner;
+		const int outputIdx;
+	};
+
+	void capture(const MidiMessage& message, int outputIdx);
+
+	// Held while a message is delivered, so that no callback runs after closeInput()
+	CriticalSection devicesLock;
+	StringArray inputDevices;
+	StringArray outputDevices;
+	Array<MidiInputCallback*> inputCallbacks;
+	DeviceListener* deviceListener = nullptr;
+
+	SpinLock captureLock;
+	std::vector<CapturedEvent> capturedEvents;
+	int numCapturedEvents = 0;
+	int numLostCaptures = 0;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopbackMidiBackend)
+};
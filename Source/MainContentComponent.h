@@ -1,66 +1,78 @@
 #pragma once
 #include "../JuceLibraryCode/JuceHeader.h"
 #include <Windows.h>
-#include "../ExternalLib/json.hpp"
 #include "MonitorComponent.h"
+#include "MeterComponent.h"
 #include "IOComponent.h"
+#include "JuceMidiBackend.h"
+#include "MidiDeviceWatcher.h"
 #include "FilesComponent.h"
+#include "Setlist.h"
+#include "RoutingEngine.h"
+#include "TrafficCounters.h"
 #include "BinaryData.h"
 #include "aubio/aubio.h"
 
-#define NUM_MIDI_CHANNELS 16
-
-#define MIN_NOTE_NUMBER 0
-#define MAX_NOTE_NUMBER 127
-#define DEFAULT_OUT_CHANNEL 1
-#define ORCHESTRA_LOW_CHANNEL 1
-#define ORCHESTRA_MID_CHANNEL 2
-#define ORCHESTRA_HIGH_CHANNEL 3
-#define ORCHESTRA_STACCATO_NOTE 12
-#define ORCHESTRA_PIZZICATO_NOTE 13
-#define ORCHESTRA_SUSTAIN_NOTE 14
-#define B3_LESLIE_CC 82
-#define B3_CHANNEL 4
-
 // GUI Constants
 #define EXT_MARGIN 5
 #define INT_MARGIN 3
 
-using json = nlohmann::json;
+// Share of the height of the monitor and the meters that the meters can take, they scroll beyond
+#define METER_MAX_HEIGHT_RATIO 0.5
 
 //==============================================================================
 class MainContentComponent : public AudioAppComponent,
-	private MidiInputCallback, ActionListener
+	private ActionListener, RoutingEngine::Listener
 {
 public:
-	MainContentComponent() : audioSetup(deviceManager,
+	MainContentComponent() : backend(new JuceMidiBackend()), watcher(*backend), io(*backend, watcher), meter(counters), files(setlist), engine(io, watcher, setlist, counters, *this), audioSetup(deviceManager,
 		0, 256, 0, 256,
 		false, false, false, false)
 	{
 		setOpaque(true);
 
+		// Session Recorder
+		File sessionsFolder = File::getSpecialLocation(File::userApplicationDataDirectory).getChildFile("MIDI Zonifier").getChildFile("Sessions");
+		sessionsFolder.createDirectory();
+		SessionRecorder::removeOldLogs(sessionsFolder, MAX_SESSION_LOGS - 1);
+		engine.getRecorder().startInBackground(sessionsFolder.getChildFile("session_" + Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S") + ".mzlog"));
+
 		addAndMakeVisible(audioSetup);
 		
 		setAudioChannels(2, 0);
 
-		// Set up device manager to pass to IO --> there should be a better way
-		devices = new AudioDeviceManager();
-
 		// MIDI IO
-		io.setDeviceManager(devices);
 		addAndMakeVisible(io);
 		io.addListener(this);
 
 		// MIDI Zones Management
 		addAndMakeVisible(files);
 		files.addListener(this);
-		currentFileIdx = 0;
-		for (uint8_t channel = 0; channel < NUM_MIDI_CHANNELS; ++channel) {
-			currentZones[channel] = initializeZones();
-		}
 
 		// MIDI Display
 		addAndMakeVisible(monitor);
+		meterViewport.setViewedComponent(&meter, false);
+		meterViewport.setScrollBarsShown(true, false);
+		addAndMakeVisible(meterViewport);
+		meter.setPortNames(io.getMidiOutputPortNames());
+
+		// OSC
+		engine.getOsc().addActionListener(this);
+		addAndMakeVisible(oscActiveButton);
+		oscActiveButton.setButtonText("Enable OSC");
+		oscActiveButton.onClick = [this] {
+			if (!oscActiveButton.getToggleState()) {
+				engine.getOsc().stop();
+			}
+			else if (!engine.getOsc().start()) {
+				oscActiveButton.setToggleState(false, dontSendNotification);
+				AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "OSC",
+					"Cannot open the UDP port " + String(OSC_DEFAULT_RECEIVE_PORT));
+			}
+		};
+		addAndMakeVisible(oscMirrorButton);
+		oscMirrorButton.setButtonText("Mirror Events over OSC");
+		oscMirrorButton.onClick = [this] { engine.getOsc().setMirrorRoutedMessages(oscMirrorButton.getToggleState()); };
 
 		// Clock
 		addAndMakeVisible(clockActiveButton);
@@ -81,7 +93,7 @@ public:
 	{
 		del_aubio_tempo(beatTracker);
 		shutdownAudio();
-		delete devices;
+		watcher.closeAllInputs();
 	}
 
 	void paint(Graphics& g) override
@@ -93,9 +105,15 @@ public:
 	{
 		io.setBounds(					EXT_MARGIN,						EXT_MARGIN,								getWidth() / 2 - INT_MARGIN *2,				getHeight() / 2 - INT_MARGIN *2);
 		files.setBounds(				getWidth() / 2 + INT_MARGIN,	EXT_MARGIN,								getWidth() / 2 - INT_MARGIN - EXT_MARGIN,	getHeight() / 2 - INT_MARGIN * 2);
-		monitor.setBounds(				EXT_MARGIN,						getHeight() / 2 + INT_MARGIN,			getWidth() / 2 - INT_MARGIN * 2,			getHeight() / 2 - INT_MARGIN - EXT_MARGIN);
+		const int meterHeight = jmin(meter.getRequiredHeight(), roundToInt((getHeight() / 2 - INT_MARGIN * 2 - EXT_MARGIN) * METER_MAX_HEIGHT_RATIO));
+		monitor.setBounds(				EXT_MARGIN,						getHeight() / 2 + INT_MARGIN,			getWidth() / 2 - INT_MARGIN * 2,			getHeight() / 2 - INT_MARGIN * 2 - EXT_MARGIN - meterHeight);
+		meterViewport.setBounds(		EXT_MARGIN,						getHeight() - EXT_MARGIN - meterHeight,	getWidth() / 2 - INT_MARGIN * 2,			meterHeight);
+		meter.setSize(meterViewport.getWidth(), meter.getRequiredHeight());
+		meter.setSize(meterViewport.getMaximumVisibleWidth(), meter.getRequiredHeight());
 		audioSetup.setBounds(			getWidth() / 2 + INT_MARGIN,	getHeight() / 2 + INT_MARGIN,			getWidth() / 2 - INT_MARGIN - EXT_MARGIN,	getHeight() / 2 - INT_MARGIN*2 - EXT_MARGIN*2 - 20);
-		clockActiveButton.setBounds(	getWidth() / 2 + INT_MARGIN,	getHeight() - EXT_MARGIN - INT_MARGIN - 20,	getWidth() / 2 - INT_MARGIN - EXT_MARGIN,	20);
+		clockActiveButton.setBounds(	getWidth() / 2 + INT_MARGIN,	getHeight() - EXT_MARGIN - INT_MARGIN - 20,	getWidth() / 6 - INT_MARGIN,				20);
+		oscActiveButton.setBounds(		getWidth() * 2 / 3 + INT_MARGIN,	getHeight() - EXT_MARGIN - INT_MARGIN - 20,	getWidth() / 6 - INT_MARGIN,			20);
+		oscMirrorButton.setBounds(		getWidth() * 5 / 6 + INT_MARGIN,	getHeight() - EXT_MARGIN - INT_MARGIN - 20,	getWidth() / 6 - INT_MARGIN - EXT_MARGIN,	20);
 	}
 
 	void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override {
@@ -122,6 +140,7 @@ public:
 			// If beat
 			if (beatTrackingResult->data[0] != 0) {
 				io.sendMIDIClockBeat();
+				engine.getArpeggiator().setTempo(aubio_tempo_get_bpm(beatTracker));
 			}
 		}
 	}
@@ -132,194 +151,54 @@ private:
 	void actionListenerCallback(const String& message) override
 	{
 		if (message[0] == 'A') {
-			devices->addMidiInputCallback(message.substring(1, message.length()), this);
+			engine.addInputSource(message.substring(1, message.length()));
 		}
 		else if (message[0] == 'D') {
-			devices->removeMidiInputCallback(message.substring(1, message.length()), this);
+			engine.removeInputSource(message.substring(1, message.length()));
 		}
 		else if (message.compare("openDirectory") == 0) {
-			setlist.clear();
-			currentFileIdx = 0;
-			programChangesList = files.getProgramChangesList();
-			bankSelectList = files.getBankSelectList();
-			setlist = files.getSetlist();
-			currentZones = setlist[currentFileIdx];
-			sendProgramChanges();
+			engine.setlistLoaded();
 		}
 		else if (message.compare("loadCCMapping") == 0) {
-			ccMapping.clear();
-			ccMappingChannels.clear();
-			ccMapping = files.getCCMapping();
-			ccMappingChannels = files.getCCMappingChannels();
+			engine.ccMappingLoaded();
 		}
-		else if (message.compare("loadPreviousFile") == 0) {
-			io.sendNoteOffToAll();
-			this->currentFileIdx = files.getCurrentFileIdx();
-			this->currentZones = setlist[currentFileIdx];
-			sendProgramChanges();
+		else if (message.compare("outputsChanged") == 0) {
+			meter.setPortNames(io.getMidiOutputPortNames());
+			resized();
 		}
-		else if (message.compare("loadNextFile") == 0) {
-			io.sendNoteOffToAll();
-			this->currentFileIdx = files.getCurrentFileIdx();
-			this->currentZones = setlist[currentFileIdx];
-			sendProgramChanges();
+		else if (message.compare("loadPreviousFile") == 0 || message.compare("loadNextFile") == 0 || message.compare("loadFile") == 0) {
+			engine.changeSong(files.getCurrentFileIdx());
 		}
-	}
-
-	void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override
-	{
-		MidiMessage newMessage(message.getRawData(), message.getRawDataSize(), message.getTimeStamp());
-		if (message.isNoteOnOrOff()) {
-			// Find the zone
-			try {
-				std::vector<int> zoneIndices = findZones(message.getChannel(), message.getNoteNumber());
-				for (int index : zoneIndices) {
-					json harmony = currentZones[message.getChannel()][index]["harmony"];
-					if (!harmony.is_null()) { // If harmony exists
-						bool isFound = false;
-						for (json harmonyEl : harmony) {
-							if (harmonyEl["inNote"] == message.getNoteNumber()) {
-								isFound = true;
-								bool canDo = true;
-								if (message.isNoteOn() && !isHarmonyNoteOn) isHarmonyNoteOn = true;
-								else if (message.isNoteOff() && !isHarmonyTwoNoteOn) isHarmonyNoteOn = false;
-								else if (message.isNoteOn() && isHarmonyNoteOn) {
-									isHarmonyTwoNoteOn = true;
-									auto newMessage = MidiMessage::allNotesOff((int)currentZones[message.getChannel()][index]["outChannel"]);
-									io.sendMIDIMessage(newMessage);
-								}
-								else if (message.isNoteOff() && isHarmonyTwoNoteOn) {
-									canDo = false;
-									isHarmonyTwoNoteOn = false;
-								}
-								// Send messages
-								if (canDo) {
-									for (auto outNote : harmonyEl["outNotes"]) {
-										newMessage.setChannel((int)currentZones[message.getChannel()][index]["outChannel"]);
-										newMessage.setNoteNumber(outNote + (int)currentZones[message.getChannel()][index]["transpose"]);
-										io.sendMIDIMessage(newMessage);
-										postMessageToList(newMessage, source->getName());
-									}
-								}
-							}
-						}
-						if (!isFound) {
-							// Change the channel
-							newMessage.setChannel((int)currentZones[message.getChannel()][index]["outChannel"]);
-							// Transpose
-							newMessage.setNoteNumber(message.getNoteNumber() + (int)currentZones[message.getChannel()][index]["transpose"]);
-							// Send message
-							io.sendMIDIMessage(newMessage);
-							postMessageToList(newMessage, source->getName());
-						}
-					}
-					else {
-						// Change the channel
-						newMessage.setChannel((int)currentZones[message.getChannel()][index]["outChannel"]);
-						// Transpose
-						newMessage.setNoteNumber(message.getNoteNumber() + (int)currentZones[message.getChannel()][index]["transpose"]);
-						// Send message
-						io.sendMIDIMessage(newMessage);
-						postMessageToList(newMessage, source->getName());
-					}
-				}
-			}
-			catch (const std::out_of_range) {
-				// No output (no zone applied)
-			}
-			catch (nlohmann::detail::type_error) {
-				// No output (no file loaded)
-			}
+		// Commands of the OSC peers
+		else if (message.compare("remoteNextFile") == 0) {
+			files.loadNextFile();
 		}
-		else if (message.isProgramChange()) {
-			const MessageManagerLock mmLock;
-			// Change current file
-			int programChangeNumber = message.getProgramChangeNumber();
-			if (programChangeNumber == 0) files.loadPreviousFile();
-			if (programChangeNumber == 1) files.loadNextFile();
-			if (programChangeNumber == 4 || programChangeNumber == 5 || programChangeNumber == 6) changeOrchestraArticulation(programChangeNumber);
-			if (programChangeNumber == 7) toggleLeslieState();
+		else if (message.compare("remotePreviousFile") == 0) {
+			files.loadPreviousFile();
 		}
-		else if (message.isController()) {
-			// Convert the CC
-			if (ccMapping.find(message.getControllerNumber()) != ccMapping.end()) {
-				auto outCCs = ccMapping[message.getControllerNumber()];
-				auto outCCsChannels = ccMappingChannels[message.getControllerNumber()];
-				for (unsigned idx = 0; idx < outCCs.size(); idx++) {
-					newMessage = MidiMessage::controllerEvent(outCCsChannels[idx], outCCs[idx], message.getControllerValue());
-					io.sendMIDIMessage(newMessage);
-					postMessageToList(newMessage, source->getName());
-				}
-			}
-		} else {
-			// MIDI Thru
-			io.sendMIDIMessage(newMessage);
-			postMessageToList(newMessage, source->getName());
+		else if (message.startsWith("remoteSelectFile")) {
+			files.loadFile(message.substring(String("remoteSelectFile").length()).getIntValue());
 		}
 	}
-	
-	void sendProgramChanges() {
-		json currentBS = bankSelectList[currentFileIdx];
-		for (auto bs : currentBS) {
-			MidiMessage newMessage = MidiMessage::controllerEvent(bs["outChannel"], 0, bs["bankNumber"]);
-			io.sendMIDIMessage(newMessage);
-		}
-		json currentPC = programChangesList[currentFileIdx];
-		for (auto pc : currentPC) {
-			MidiMessage newMessage = MidiMessage::programChange(pc["outChannel"], pc["programChangeNumber"]);
-			io.sendMIDIMessage(newMessage);
-		}
-	}
-
-	void changeOrchestraArticulation(int programChangeNumber) {
-		int noteNumber;
-		if (programChangeNumber == 4) {
-			noteNumber = ORCHESTRA_SUSTAIN_NOTE;
-		}
-		else if (programChangeNumber == 5) {
-			noteNumber = ORCHESTRA_STACCATO_NOTE;
-		}
-		else {
-			noteNumber = ORCHESTRA_PIZZICATO_NOTE;
-		}
-		auto newMessage = MidiMessage::noteOn(ORCHESTRA_LOW_CHANNEL, noteNumber, (uint8)127);
-		io.sendMIDIMessage(newMessage);
-		newMessage = MidiMessage::noteOff(ORCHESTRA_LOW_CHANNEL, noteNumber);
-		io.sendMIDIMessage(newMessage);
-		newMessage = MidiMessage::noteOn(ORCHESTRA_MID_CHANNEL, noteNumber, (uint8)127);
-		io.sendMIDIMessage(newMessage);
-		newMessage = MidiMessage::noteOff(ORCHESTRA_MID_CHANNEL, noteNumber);
-		io.sendMIDIMessage(newMessage);
-		newMessage = MidiMessage::noteOn(ORCHESTRA_HIGH_CHANNEL, noteNumber, (uint8)127);
-		io.sendMIDIMessage(newMessage);
-		newMessage = MidiMessage::noteOff(ORCHESTRA_HIGH_CHANNEL, noteNumber);
-		io.sendMIDIMessage(newMessage);
-	}
 
-	void toggleLeslieState() {
-		auto newMessage = MidiMessage::controllerEvent(B3_CHANNEL, B3_LESLIE_CC, 127*leslieState);
-		io.sendMIDIMessage(newMessage);
-		leslieState = !leslieState;
+	// The messages routed from an input are shown on the monitor
+	void messageRouted(const MidiMessage& message, int /*port*/, bool /*isQueued*/, const String& sourceName) override
+	{
+		if (sourceName.isNotEmpty())
+			postMessageToList(message, sourceName);
 	}
 
-	json initializeZones() {
-		json ret = {
-			{"startNote", MIN_NOTE_NUMBER},
-			{"endNote", MAX_NOTE_NUMBER},
-			{"outChannel", DEFAULT_OUT_CHANNEL},
-			{"transpose", 0}
-		};
-		return ret;
+	void songChangeRequested(int delta) override
+	{
+		const MessageManagerLock mmLock;
+		if (delta < 0) files.loadPreviousFile();
+		else files.loadNextFile();
 	}
 
-	std::vector<int> findZones(int inChannel, int noteNumber) {
-		std::vector<int> ret;
-		for (int zoneIdx = 0; zoneIdx < currentZones[inChannel].size(); ++zoneIdx) {
-			if (((int)(currentZones[inChannel][zoneIdx]["startNote"]) <= noteNumber) && (noteNumber <= (int)(currentZones[inChannel][zoneIdx]["endNote"]))) {
-				ret.push_back(zoneIdx);
-			}
-		}
-		return ret;
+	void inputSourcesChanged(const StringArray& sourceNames) override
+	{
+		meter.setSourceNames(sourceNames);
+		resized();
 	}
 
 	// This is used to dispach an incoming message to the message thread
@@ -372,35 +251,27 @@ private:
 	}
 
 	//==============================================================================
-	AudioDeviceManager* devices;
+	// MIDI Devices
+	std::unique_ptr<MidiBackend> backend;
+	MidiDeviceWatcher watcher;
 	
 	// MIDI IO
 	IOComponent io;
 
 	// MIDI Display
 	MonitorComponent monitor;
+	TrafficCounters counters;
+	MeterComponent meter;
+	Viewport meterViewport;
 
 	// Zone File Management
+	Setlist setlist;
 	FilesComponent files;
-	
-	// Zones Management
-	std::map<uint8_t, json> currentZones;
-	std::vector<std::map<uint8_t, json>> setlist;
-	std::vector<String> setlistNames;
-	std::vector<json> programChangesList;
-	std::vector<json> bankSelectList;
-	int currentFileIdx;
-	
-	// CC Management
-	std::map<int, std::vector<int>> ccMapping;
-	std::map<int, std::vector<int>> ccMappingChannels;
-	
-	// B3 Leslie Management
-	bool leslieState = false;
-	
-	// Harmony NoteOnOff
-	bool isHarmonyNoteOn = false;
-	bool isHarmonyTwoNoteOn = false;
+
+	// Routing, Session Recorder, OSC Endpoint and Arpeggiator (after everything they use)
+	RoutingEngine engine;
+	ToggleButton oscActiveButton;
+	ToggleButton oscMirrorButton;
 
 	// Clock
 		// Audio In
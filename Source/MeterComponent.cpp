@@ -0,0 +1,140 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeterComponent.h"
+
+MeterComponent::MeterComponent(TrafficCounters& c) : counters(c), previousTime(Time::getMillisecondCounterHiRes() * 0.001)
+{
+	counters.takeSnapshot(previousSnapshot);
+	currentSnapshot = previousSnapshot;
+	startTimer(METER_UPDATE_INTERVAL_MS);
+}
+
+MeterComponent::~MeterComponent()
+{
+	stopTimer();
+}
+
+void MeterComponent::paint(Graphics& g)
+{
+	g.fillAll(Colour(0x32ffffff));
+	g.setFont(Font(METER_ROW_HEIGHT * 0.8f));
+
+	auto area = getLocalBounds().reduced(METER_MARGIN);
+
+	// Totals since the start, first so that they are visible without scrolling
+	g.setColour(currentSnapshot.dropped > 0 ? Colours::orange : Colours::white);
+	g.drawText("Dropped: " + String(currentSnapshot.dropped) + "   Filtered: " + String(currentSnapshot.filtered),
+		area.removeFromTop(METER_ROW_HEIGHT), Justification::centredLeft, true);
+
+	// Message types
+	String types;
+	for (int type = 0; type < TrafficCounters::numMessageTypes; ++type) {
+		types << TrafficCounters::getMessageTypeName(type) << " " << roundToInt(typeRates[type]) << "   ";
+	}
+	g.setColour(Colours::white);
+	g.drawText(types, area.removeFromTop(METER_ROW_HEIGHT), Justification::centredLeft, true);
+
+	// Inputs and outputs
+	for (int id = 0; id < jmin(sourceNames.size(), MAX_COUNTED_SOURCES); ++id) {
+		paintRateRow(g, area.removeFromTop(METER_ROW_HEIGHT), "In: " + sourceNames[id], sourceMessageRates[id], sourceByteRates[id]);
+	}
+	if (sourceNames.size() > MAX_COUNTED_SOURCES)
+		paintRateRow(g, area.removeFromTop(METER_ROW_HEIGHT), "In: " + String(sourceNames.size() - MAX_COUNTED_SOURCES) + " more", otherSourceMessageRate, otherSourceByteRate);
+	for (int port = 0; port < jmin(portNames.size(), MAX_COUNTED_PORTS); ++port) {
+		paintRateRow(g, area.removeFromTop(METER_ROW_HEIGHT), "Out: " + portNames[port], portMessageRates[port], portByteRates[port]);
+	}
+	if (portNames.size() > MAX_COUNTED_PORTS)
+		paintRateRow(g, area.removeFromTop(METER_ROW_HEIGHT), "Out: " + String(portNames.size() - MAX_COUNTED_PORTS) + " more", otherPortMessageRate, otherPortByteRate);
+
+	// Channels
+	paintChannelRow(g, area.removeFromTop(METER_ROW_HEIGHT), "In Channels", inChannelRates);
+	paintChannelRow(g, area.removeFromTop(METER_ROW_HEIGHT), "Out Channels", outChannelRates);
+}
+
+void MeterComponent::paintRateRow(Graphics& g, Rectangle<int> row, const String& name, double messageRate, double byteRate)
+{
+	g.setColour(Colours::white);
+	g.drawText(name, row.removeFromLeft(METER_NAME_WIDTH), Justification::centredLeft, true);
+	g.drawText(String(roundToInt(messageRate)) + " msg/s   " + String(roundToInt(byteRate)) + " B/s", row, Justification::centredLeft, true);
+}
+
+void MeterComponent::paintChannelRow(Graphics& g, Rectangle<int> row, const String& name, const double* channelRates)
+{
+	g.setColour(Colours::white);
+	g.drawText(name, row.removeFromLeft(METER_NAME_WIDTH), Justification::centredLeft, true);
+	const int cellWidth = row.getWidth() / NUM_COUNTED_CHANNELS;
+	for (int channel = 0; channel < NUM_COUNTED_CHANNELS; ++channel) {
+		auto cell = row.removeFromLeft(cellWidth).reduced(1);
+		g.setColour(Colours::darkgrey);
+		g.fillRect(cell);
+		if (channelRates[channel] > 0) {
+			// Logarithmic: 1 msg/s is barely visible, 1000 msg/s fills the cell
+			float level = jlimit(0.1f, 1.0f, (float)std::log10(channelRates[channel] + 1.0) / 3.0f);
+			g.setColour(Colours::limegreen);
+			g.fillRect(cell.removeFromBottom(roundToInt(cell.getHeight() * level)));
+		}
+	}
+}
+
+void MeterComponent::resized()
+{
+}
+
+int MeterComponent::getNumRows()
+{
+	// Totals, types, one per source and port (plus one for the uncounted ones), two channel rows
+	const int numSourceRows = jmin(sourceNames.size(), MAX_COUNTED_SOURCES + 1);
+	const int numPortRows = jmin(portNames.size(), MAX_COUNTED_PORTS + 1);
+	return 2 + numSourceRows + numPortRows + 2;
+}
+
+int MeterComponent::getRequiredHeight()
+{
+	return getNumRows() * METER_ROW_HEIGHT + METER_MARGIN * 2;
+}
+
+void MeterComponent::setSourceNames(const StringArray& names)
+{
+	sourceNames = names;
+	setSize(getWidth(), getRequiredHeight());
+	repaint();
+}
+
+void MeterComponent::setPortNames(const StringArray& names)
+{
+	portNames = names;
+	setSize(getWidth(), getRequiredHeight());
+	repaint();
+}
+
+void MeterComponent::timerCallback()
+{
+	const double now = Time::getMillisecondCounterHiRes() * 0.001;
+	const double elapsed = now - previousTime;
+	if (elapsed <= 0) return;
+	counters.takeSnapshot(currentSnapshot);
+
+	for (int id = 0; id < MAX_COUNTED_SOURCES; ++id) {
+		sourceMessageRates[id] = (currentSnapshot.sourceMessages[id] - previousSnapshot.sourceMessages[id]) / elapsed;
+		sourceByteRates[id] = (currentSnapshot.sourceBytes[id] - previousSnapshot.sourceBytes[id]) / elapsed;
+	}
+	for (int channel = 0; channel < NUM_COUNTED_CHANNELS; ++channel) {
+		inChannelRates[channel] = (currentSnapshot.inChannelMessages[channel] - previousSnapshot.inChannelMessages[channel]) / elapsed;
+		outChannelRates[channel] = (currentSnapshot.outChannelMessages[channel] - previousSnapshot.outChannelMessages[channel]) / elapsed;
+	}
+	for (int type = 0; type < TrafficCounters::numMessageTypes; ++type) {
+		typeRates[type] = (currentSnapshot.typeMessages[type] - previousSnapshot.typeMessages[type]) / elapsed;
+	}
+	for (int port = 0; port < MAX_COUNTED_PORTS; ++port) {
+		portMessageRates[port] = (currentSnapshot.portMessages[port] - previousSnapshot.portMessages[port]) / elapsed;
+		portByteRates[port] = (currentSnapshot.portBytes[port] - previousSnapshot.portBytes[port]) / elapsed;
+	}
+
+	otherSourceMessageRate = (currentSnapshot.otherSourceMessages - previousSnapshot.otherSourceMessages) / elapsed;
+	otherSourceByteRate = (currentSnapshot.otherSourceBytes - previousSnapshot.otherSourceBytes) / elapsed;
+	otherPortMessageRate = (currentSnapshot.otherPortMessages - previousSnapshot.otherPortMessages) / elapsed;
+	otherPortByteRate = (currentSnapshot.otherPortBytes - previousSnapshot.otherPortBytes) / elapsed;
+
+	previousSnapshot = currentSnapshot;
+	previousTime = now;
+	repaint();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrafficCounters.h"
+
+#define METER_UPDATE_INTERVAL_MS 500
+#define METER_ROW_HEIGHT 16
+#define METER_NAME_WIDTH 160
+#define METER_MARGIN 4
+
+// Shows the traffic of every input source and output port, and of every channel,
+// from the lock-free counters: they are read on a timer instead of logging each message.
+// Its height grows with the number of sources and ports, the owner shows it in a Viewport.
+class MeterComponent    : public Component, private Timer
+{
+public:
+    MeterComponent(TrafficCounters& counters);
+    ~MeterComponent();
+
+    void paint (Graphics&) override;
+    void resized() override;
+
+	void setSourceNames(const StringArray& names);
+	void setPortNames(const StringArray& names);
+	int getRequiredHeight();
+
+private:
+	void timerCallback() override;
+	void paintRateRow(Graphics& g, Rectangle<int> row, const String& name, double messageRate, double byteRate);
+	void paintChannelRow(Graphics& g, Rectangle<int> row, const String& name, const double* channelRates);
+	int getNumRows();
+
+	TrafficCounters& counters;
+	TrafficCounters::Snapshot previousSnapshot;
+	TrafficCounters::Snapshot currentSnapshot;
+	double previousTime;
+
+	// Rates of the last interval, per second
+	double sourceMessageRates[MAX_COUNTED_SOURCES] = {};
+	double sourceByteRates[MAX_COUNTED_SOURCES] = {};
+	double inChannelRates[NUM_COUNTED_CHANNELS] = {};
+	double outChannelRates[NUM_COUNTED_CHANNELS] = {};
+	double typeRates[TrafficCounters::numMessageTypes] = {};
+	double portMessageRates[MAX_COUNTED_PORTS] = {};
+	double portByteRates[MAX_COUNTED_PORTS] = {};
+	double otherSourceMessageRate = 0;
+	double otherSourceByteRate = 0;
+	double otherPortMessageRate = 0;
+	double otherPortByteRate = 0;
+
+	StringArray sourceNames;
+	StringArray portNames;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterComponent)
+};
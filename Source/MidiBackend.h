@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Where MIDI devices come from: the real ports of the system, virtual ports, or an
+// in-process loopback that lets a test drive the whole path without any hardware.
+// Devices are always identified by name.
+class MidiBackend
+{
+public:
+	class Output
+	{
+	public:
+		virtual ~Output() {}
+		virtual void sendMessageNow(const MidiMessage& message) = 0;
+	};
+
+	// Told, from any thread, that the system reports a device plugged or unplugged: a device
+	// unplugged and plugged back between two scans of the lists has the same name, but its
+	// open input is dead and must be opened again
+	class DeviceListener
+	{
+	public:
+		virtual ~DeviceListener() {}
+		virtual void devicesChanged(bool hasRemovedDevice) = 0;
+	};
+
+	virtual ~MidiBackend() {}
+
+	virtual StringArray getInputDevices() = 0;
+	virtual StringArray getOutputDevices() = 0;
+
+	// The callback is called from the thread of the backend (the MIDI thread);
+	// its MidiInput* argument may be null
+	virtual bool openInput(const String& name, MidiInputCallback* callback) = 0;
+	virtual void closeInput(const String& name) = 0;
+
+	// Returns nullptr if the device is not available
+	virtual std::unique_ptr<Output> openOutput(const String& name) = 0;
+
+	// Backends without notifications never call the listener: their devices are only scanned
+	virtual void setDeviceListener(DeviceListener* listener) {}
+};
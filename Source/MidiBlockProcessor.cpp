@@ -0,0 +1,117 @@
+#include <JuceHeader.h>
+#include "MidiBlockProcessor.h"
+
+MidiBlockProcessor::MidiBlockProcessor(ZoneRouter& r) : router(r)
+{
+	router.setArpeggiator(&arpeggiator);
+}
+
+MidiBlockProcessor::~MidiBlockProcessor()
+{
+	router.setArpeggiator(nullptr);
+}
+
+void MidiBlockProcessor::prepare(double newSampleRate)
+{
+	routedMidi.ensureSize(ROUTED_MIDI_BUFFER_SIZE);
+	overflowMidi.ensureSize(OVERFLOW_MIDI_BUFFER_SIZE);
+	numDropped = 0;
+	// The clock goes on from where it was, at the new rate; the patterns start again
+	clockStartTime = getSampleTime(0);
+	numProcessedSamples = 0;
+	if (newSampleRate > 0.0) sampleRate = newSampleRate;
+	arpeggiator.stopAll();
+}
+
+void MidiBlockProcessor::requestConfiguration(int configurationIdx)
+{
+	requestedConfigurationIdx = configurationIdx;
+}
+
+void MidiBlockProcessor::setTempo(double beatsPerMinute)
+{
+	arpeggiator.setTempo(beatsPerMinute);
+}
+
+bool MidiBlockProcessor::processBlock(MidiBuffer& midiMessages, int numSamples)
+{
+	routedMidi.clear();
+	overflowMidi.clear();
+	routedEvents.clear();
+	arpeggiatorEvents.clear();
+	arpeggiatorOutput.numDropped = 0;
+	blockSize = numSamples;
+	hasSelectedConfiguration = false;
+	ProcessorOutput output(*this, routedEvents, overflowMidi);
+
+	// Song changes requested from the editor
+	int configurationIdx = requestedConfigurationIdx.exchange(-1);
+	if (configurationIdx >= 0) selectConfiguration(configurationIdx, output);
+
+	// SysEx messages are not routed, they go straight to the output
+	MidiBuffer::Iterator iter(midiMessages);
+	int longMessageBytesLeft = MAX_LONG_MESSAGE_BYTES;
+	int numDroppedLongMessages = 0;
+	int lastSamplePosition = 0;
+	do {
+		inputEvents.clear();
+		numDroppedLongMessages += inputEvents.addFromMidiBuffer(iter, routedMidi, longMessageBytesLeft);
+		if (inputEvents.size() > 0) lastSamplePosition = inputEvents.samplePosition[inputEvents.size() - 1];
+		router.processEventBlock(inputEvents, output);
+	} while (inputEvents.size() == inputEvents.getCapacity());
+	// The Note Offs beyond the overflow buffer
+	for (int chIdx = 1; chIdx <= NUM_MIDI_CHANNELS; ++chIdx) {
+		if ((output.overflowChannels & (1u << (chIdx - 1))) != 0) overflowMidi.addEvent(MidiMessage::allNotesOff(chIdx), lastSamplePosition);
+	}
+	// The steps due until the last sample; the later ones are played by the next block
+	arpeggiator.advanceTo(getSampleTime(jmax(0, numSamples - 1)));
+	numProcessedSamples += numSamples;
+
+	// A step goes after the routed events of its sample, as the steps of the arpeggiator thread
+	// of the application follow the event they are due at
+	routedEvents.copyToMidiBuffer(routedMidi);
+	routedMidi.addEvents(overflowMidi, 0, -1, 0);
+	arpeggiatorEvents.copyToMidiBuffer(routedMidi);
+	const int numDroppedEvents = output.numDropped + arpeggiatorOutput.numDropped + numDroppedLongMessages;
+	if (numDroppedEvents > 0) numDropped.fetch_add(numDroppedEvents, std::memory_order_relaxed);
+	jassert((routedEvents.size() + arpeggiatorEvents.size()) * MIDI_BUFFER_BYTES_PER_EVENT + (output.numOverflowEvents + NUM_MIDI_CHANNELS) * MIDI_BUFFER_BYTES_PER_EVENT
+		+ MAX_LONG_MESSAGE_BYTES - longMessageBytesLeft <= ROUTED_MIDI_BUFFER_SIZE);
+
+	// Copied back instead of swapped, so that routedMidi keeps the storage reserved in prepare().
+	// The host buffer cannot be reached before the first block: hosts keep the same buffer
+	// from block to block, so it only grows here once.
+	midiMessages.clear();
+	midiMessages.ensureSize(ROUTED_MIDI_BUFFER_SIZE);
+	midiMessages.addEvents(routedMidi, 0, -1, 0);
+	return hasSelectedConfiguration;
+}
+
+int MidiBlockProcessor::getNumDropped()
+{
+	return numDropped.load(std::memory_order_relaxed);
+}
+
+void MidiBlockProcessor::selectConfiguration(int configurationIdx, ProcessorOutput& output)
+{
+	if (configurationIdx < 0 || configurationIdx >= router.getNumConfigurations()) return;
+	// The patterns stop at the sample of the song change
+	arpeggiator.advanceTo(output.getEventTime());
+	for (int chIdx = 1; chIdx <= NUM_MIDI_CHANNELS; ++chIdx) {
+		output.routeMidiMessage(MidiMessage::allNotesOff(chIdx), DEFAULT_OUTPUT_PORT);
+	}
+	router.selectConfiguration(configurationIdx, output);
+	hasSelectedConfiguration = true;
+}
+
+double MidiBlockProcessor::getSampleTime(int samplePosition)
+{
+	return clockStartTime + (numProcessedSamples + samplePosition) / sampleRate;
+}
+
+void MidiBlockProcessor::ArpeggiatorOutput::routeMidiMessage(const MidiMessage& message, int port)
+{
+	// Steps due before the block (ends of patterns, late keys on the clock grid) go to its first sample
+	const double position = (message.getTimeStamp() - owner.getSampleTime(0)) * owner.sampleRate;
+	samplePosition = jlimit(0, jmax(0, owner.blockSize - 1), roundToInt(position));
+	BlockOutput::routeMidiMessage(message, port);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Setlist.h"
+#include "ZoneRouter.h"
+#include "Arpeggiator.h"
+#include "MidiEventBlock.h"
+
+// Preallocated for one block (harmonies multiply the events). Larger input blocks are routed
+// in several passes; routed events beyond MAX_ROUTED_EVENTS are dropped, except the Note Offs
+// (beyond MAX_OVERFLOW_EVENTS, an All Notes Off on their channel), and the SysEx messages
+// beyond MAX_LONG_MESSAGE_BYTES are dropped
+#define MAX_INPUT_EVENTS 2048
+#define MAX_ROUTED_EVENTS 8192
+#define MAX_OVERFLOW_EVENTS 1024
+#define MAX_LONG_MESSAGE_BYTES 65536
+// Steps of the arpeggiated zones in a block, beyond which they are dropped
+#define MAX_ARPEGGIATOR_EVENTS 2048
+#define MIDI_BUFFER_BYTES_PER_EVENT (MIDI_BUFFER_EVENT_HEADER_SIZE + 3)
+#define OVERFLOW_MIDI_BUFFER_SIZE ((MAX_OVERFLOW_EVENTS + NUM_MIDI_CHANNELS) * MIDI_BUFFER_BYTES_PER_EVENT)
+// The most that a block can hand back to the host
+#define ROUTED_MIDI_BUFFER_SIZE ((MAX_ROUTED_EVENTS + MAX_ARPEGGIATOR_EVENTS) * MIDI_BUFFER_BYTES_PER_EVENT + OVERFLOW_MIDI_BUFFER_SIZE + MAX_LONG_MESSAGE_BYTES)
+// Time of the first sample on the clock of the arpeggiator, for which 0 means "nothing scheduled"
+#define ARPEGGIATOR_SAMPLE_CLOCK_START 1.0
+
+// Routes a host MidiBuffer in place, one block at a time, keeping the sample offsets of the
+// events. This is the processing of the plugin without the plugin around it, so that the
+// tools can drive it as a host does. Nothing is allocated after prepare().
+// The arpeggiated zones are played by an arpeggiator without its own thread, on the clock of
+// the samples: it is advanced to every arpeggiated note and song change, then to the last
+// sample of the block, and its steps are placed at the sample of their time.
+class MidiBlockProcessor
+{
+public:
+	MidiBlockProcessor(ZoneRouter& router);
+	~MidiBlockProcessor();
+
+	// Not called from the audio thread
+	void prepare(double sampleRate);
+	// Can be called from any thread: the configuration is selected at the start of the next block
+	void requestConfiguration(int configurationIdx);
+	// The tempo of the host, for the next blocks
+	void setTempo(double beatsPerMinute);
+	// Returns true if the current configuration changed during the block. The host buffer
+	// grows to ROUTED_MIDI_BUFFER_SIZE at its first block, and never after.
+	bool processBlock(MidiBuffer& midiMessages, int numSamples);
+	// Routed events, arpeggiator steps and SysEx messages that did not fit in a block, since prepare()
+	int getNumDropped();
+
+private:
+	// Song changes happen inside the block, at the position of the Program Change
+	class ProcessorOutput : public ZoneRouter::BlockOutput
+	{
+	public:
+		ProcessorOutput(MidiBlockProcessor& o, MidiEventBlock& e, MidiBuffer& overflow)
+			: BlockOutput(e, &overflow, MAX_OVERFLOW_EVENTS), owner(o)
+		{}
+
+		void songChangeRequested(int delta) override
+		{
+			owner.selectConfiguration(owner.router.getCurrentConfigurationIdx() + delta, *this);
+		}
+
+		double getEventTime() override
+		{
+			return owner.getSampleTime(samplePosition);
+		}
+
+		MidiBlockProcessor& owner;
+	};
+
+	// Places the steps at the sample of their time, in the current block
+	class ArpeggiatorOutput : public ZoneRouter::BlockOutput
+	{
+	public:
+		ArpeggiatorOutput(MidiBlockProcessor& o, MidiEventBlock& e)
+			: BlockOutput(e), owner(o)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+
+		MidiBlockProcessor& owner;
+	};
+
+	void selectConfiguration(int configurationIdx, ProcessorOutput& output);
+	double getSampleTime(int samplePosition);
+
+	ZoneRouter& router;
+	MidiEventBlock inputEvents { MAX_INPUT_EVENTS };
+	MidiEventBlock routedEvents { MAX_ROUTED_EVENTS };
+	MidiBuffer routedMidi;
+	MidiBuffer overflowMidi;
+	std::atomic<int> numDropped { 0 };
+	std::atomic<int> requestedConfigurationIdx { -1 };
+	bool hasSelectedConfiguration = false;
+
+	// Sample clock: the time of the first sample after prepare(), and the samples since then
+	double sampleRate = 44100.0;
+	double clockStartTime = ARPEGGIATOR_SAMPLE_CLOCK_START;
+	int64 numProcessedSamples = 0;
+	int blockSize = 0;
+
+	// Arpeggiated zones (after everything their output uses)
+	MidiEventBlock arpeggiatorEvents { MAX_ARPEGGIATOR_EVENTS };
+	ArpeggiatorOutput arpeggiatorOutput { *this, arpeggiatorEvents };
+	Arpeggiator arpeggiator { arpeggiatorOutput, false };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiBlockProcessor)
+};
@@ -0,0 +1,164 @@
+#include <JuceHeader.h>
+#include "MidiDeviceWatcher.h"
+
+MidiDeviceWatcher::MidiDeviceWatcher(MidiBackend& b) : Thread("MIDI Device Watcher"), backend(b)
+{
+	backend.setDeviceListener(this);
+	startThread();
+}
+
+MidiDeviceWatcher::~MidiDeviceWatcher()
+{
+	backend.setDeviceListener(nullptr);
+	closeAllInputs();
+}
+
+void MidiDeviceWatcher::run()
+{
+	bool hasScanned = false;
+	double removalScanEndTime = 0.0;
+	while (!threadShouldExit()) {
+		// The system may report the removal before the device has left the lists
+		if (isRemovalReported.exchange(false))
+			removalScanEndTime = Time::getMillisecondCounterHiRes() + MIDI_DEVICE_REMOVAL_SCAN_TIMEOUT_MS;
+		// Enumerating can take long with some USB drivers: the lists are replaced only afterwards
+		StringArray newInputDevices = backend.getInputDevices();
+		StringArray newOutputDevices = backend.getOutputDevices();
+		bool hasChanged = !hasScanned;
+		{
+			const ScopedLock sl(devicesLock);
+			if (newInputDevices != inputDevices || newOutputDevices != outputDevices) {
+				for (auto& name : inputDevices) {
+					if (!newInputDevices.contains(name)) removalScanEndTime = 0.0;
+				}
+				for (auto& name : outputDevices) {
+					if (!newOutputDevices.contains(name)) removalScanEndTime = 0.0;
+				}
+				inputDevices = newInputDevices;
+				outputDevices = newOutputDevices;
+				hasChanged = true;
+			}
+		}
+		if (hasChanged) {
+			{
+				const ScopedLock sl(inputsLock);
+				for (auto& input : inputs) input.hasFailed = false;
+			}
+			sendActionMessage("devicesChanged");
+			hasScanned = true;
+		}
+		updateInputs();
+		const bool isWaitingForRemoval = Time::getMillisecondCounterHiRes() < removalScanEndTime;
+		inputsChanged.wait(isWaitingForRemoval ? MIDI_DEVICE_REMOVAL_SCAN_INTERVAL_MS : MIDI_DEVICE_SCAN_INTERVAL_MS);
+	}
+}
+
+StringArray MidiDeviceWatcher::getInputDevices()
+{
+	const ScopedLock sl(devicesLock);
+	return inputDevices;
+}
+
+StringArray MidiDeviceWatcher::getOutputDevices()
+{
+	const ScopedLock sl(devicesLock);
+	return outputDevices;
+}
+
+void MidiDeviceWatcher::enableInput(const String& name, MidiInputCallback* callback)
+{
+	{
+		const ScopedLock sl(inputsLock);
+		auto input = std::find_if(inputs.begin(), inputs.end(), [&name](const WatchedInput& i) { return i.name == name; });
+		if (input == inputs.end()) inputs.push_back({ name, callback, true, false, false });
+		else {
+			input->callback = callback;
+			input->isEnabled = true;
+			input->hasFailed = false;
+		}
+	}
+	inputsChanged.signal();
+}
+
+void MidiDeviceWatcher::disableInput(const String& name)
+{
+	{
+		const ScopedLock sl(inputsLock);
+		for (auto& input : inputs) {
+			if (input.name == name) input.isEnabled = false;
+		}
+	}
+	inputsChanged.signal();
+}
+
+StringArray MidiDeviceWatcher::getEnabledInputs()
+{
+	StringArray names;
+	const ScopedLock sl(inputsLock);
+	for (auto& input : inputs) {
+		if (input.isEnabled) names.add(input.name);
+	}
+	return names;
+}
+
+bool MidiDeviceWatcher::isInputOpen(const String& name)
+{
+	const ScopedLock sl(inputsLock);
+	for (auto& input : inputs) {
+		if (input.name == name) return input.isOpen;
+	}
+	return false;
+}
+
+void MidiDeviceWatcher::closeAllInputs()
+{
+	signalThreadShouldExit();
+	inputsChanged.signal();
+	stopThread(MIDI_DEVICE_THREAD_STOP_TIMEOUT_MS);
+	const ScopedLock sl(inputsLock);
+	for (auto& input : inputs) {
+		if (input.isOpen) backend.closeInput(input.name);
+		input.isOpen = false;
+		input.isEnabled = false;
+	}
+}
+
+// From the thread of the backend that reports it: the lists are scanned at once
+void MidiDeviceWatcher::devicesChanged(bool hasRemovedDevice)
+{
+	if (hasRemovedDevice) isRemovalReported = true;
+	inputsChanged.signal();
+}
+
+void MidiDeviceWatcher::updateInputs()
+{
+	// Devices are opened and closed outside of the lock, so that enabling an input never waits for a driver
+	std::vector<WatchedInput> snapshot;
+	{
+		const ScopedLock sl(inputsLock);
+		snapshot = inputs;
+	}
+	const StringArray connectedDevices = getInputDevices();
+	for (auto& input : snapshot) {
+		const bool isConnected = connectedDevices.contains(input.name);
+		bool isOpen = input.isOpen;
+		bool hasFailed = input.hasFailed;
+		if (isOpen && (!input.isEnabled || !isConnected)) {
+			// Disabled, or unplugged: closed now, reopened when the device is back
+			backend.closeInput(input.name);
+			isOpen = false;
+		}
+		else if (!isOpen && input.isEnabled && isConnected && !hasFailed) {
+			isOpen = backend.openInput(input.name, input.callback);
+			hasFailed = !isOpen;
+		}
+		else continue;
+
+		const ScopedLock sl(inputsLock);
+		for (auto& watchedInput : inputs) {
+			if (watchedInput.name != input.name) continue;
+			watchedInput.isOpen = isOpen;
+			watchedInput.hasFailed = hasFailed;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiBackend.h"
+
+#define MIDI_DEVICE_SCAN_INTERVAL_MS 250
+#define MIDI_DEVICE_THREAD_STOP_TIMEOUT_MS 2000
+// Once the system reports an unplugged device, the lists are scanned this often until it has left them
+#define MIDI_DEVICE_REMOVAL_SCAN_INTERVAL_MS 10
+#define MIDI_DEVICE_REMOVAL_SCAN_TIMEOUT_MS 1000
+
+// Keeps the MIDI devices up to date without ever blocking the message thread: the devices are
+// enumerated on this thread, which also opens the enabled inputs. An enabled input is
+// remembered: it is closed when its device disappears and opened again as soon as it is back.
+// The lists are scanned at once when the backend reports a device plugged or unplugged, so that
+// a device plugged back before the next scan is still seen leaving.
+// Every change of the device lists is announced with the action message "devicesChanged".
+class MidiDeviceWatcher : public Thread, public ActionBroadcaster, private MidiBackend::DeviceListener
+{
+public:
+	MidiDeviceWatcher(MidiBackend& backend);
+	~MidiDeviceWatcher();
+
+	void run() override;
+
+	// The devices found by the last scan (empty until the first one)
+	StringArray getInputDevices();
+	StringArray getOutputDevices();
+
+	// The input is opened by the watcher thread whenever its device is connected, and closed
+	// there after disableInput(): the callback must stay valid until closeAllInputs()
+	void enableInput(const String& name, MidiInputCallback* callback);
+	void disableInput(const String& name);
+	StringArray getEnabledInputs();
+	bool isInputOpen(const String& name);
+
+	// Stops the thread and closes every input before returning
+	void closeAllInputs();
+
+private:
+	struct WatchedInput
+	{
+		String name;
+		MidiInputCallback* callback;
+		bool isEnabled;
+		bool isOpen;
+		// Not retried until the device list changes
+		bool hasFailed;
+	};
+
+	void devicesChanged(bool hasRemovedDevice) override;
+	void updateInputs();
+
+	MidiBackend& backend;
+
+	CriticalSection devicesLock;
+	StringArray inputDevices;
+	StringArray outputDevices;
+
+	CriticalSection inputsLock;
+	std::vector<WatchedInput> inputs;
+
+	WaitableEvent inputsChanged;
+	std::atomic<bool> isRemovalReported { false };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiDeviceWatcher)
+};
@@ -0,0 +1,89 @@
+#include <JuceHeader.h>
+#include "MidiEventBlock.h"
+
+MidiEventBlock::MidiEventBlock(int capacity)
+	: status((size_t)capacity), data1((size_t)capacity), data2((size_t)capacity),
+	  samplePosition((size_t)capacity), port((size_t)capacity), transpose((size_t)capacity),
+	  capacity(capacity)
+{
+}
+
+MidiEventBlock::~MidiEventBlock()
+{
+}
+
+void MidiEventBlock::clear()
+{
+	numEvents = 0;
+}
+
+void MidiEventBlock::truncate(int newSize)
+{
+	numEvents = jlimit(0, numEvents, newSize);
+}
+
+int MidiEventBlock::size() const
+{
+	return numEvents;
+}
+
+int MidiEventBlock::getCapacity() const
+{
+	return capacity;
+}
+
+bool MidiEventBlock::addEvent(uint8 newStatus, uint8 newData1, uint8 newData2, int newSamplePosition, int newPort, int newTranspose)
+{
+	if (numEvents >= capacity) return false;
+	status[numEvents] = newStatus;
+	data1[numEvents] = newData1;
+	data2[numEvents] = newData2;
+	samplePosition[numEvents] = newSamplePosition;
+	port[numEvents] = newPort;
+	transpose[numEvents] = newTranspose;
+	++numEvents;
+	return true;
+}
+
+void MidiEventBlock::copyEvent(int fromIdx, int toIdx)
+{
+	status[toIdx] = status[fromIdx];
+	data1[toIdx] = data1[fromIdx];
+	data2[toIdx] = data2[fromIdx];
+	samplePosition[toIdx] = samplePosition[fromIdx];
+	port[toIdx] = port[fromIdx];
+	transpose[toIdx] = transpose[fromIdx];
+}
+
+int MidiEventBlock::addFromMidiBuffer(MidiBuffer::Iterator& iter, MidiBuffer& longMessages, int& longMessageBytesLeft)
+{
+	const uint8* midiData;
+	int numBytes, position;
+	int numDropped = 0;
+	while (numEvents < capacity && iter.getNextEvent(midiData, numBytes, position)) {
+		if (numBytes <= 3) addEvent(midiData[0], numBytes > 1 ? midiData[1] : 0, numBytes > 2 ? midiData[2] : 0, position);
+		else if (numBytes + MIDI_BUFFER_EVENT_HEADER_SIZE > longMessageBytesLeft) ++numDropped;
+		else {
+			longMessages.addEvent(midiData, numBytes, position);
+			longMessageBytesLeft -= numBytes + MIDI_BUFFER_EVENT_HEADER_SIZE;
+		}
+	}
+	return numDropped;
+}
+
+int MidiEventBlock::addFromRawEvents(const uint8* events, const int* samplePositions, int numRawEvents)
+{
+	int idx = 0;
+	for (; idx < numRawEvents; ++idx) {
+		if (!addEvent(events[idx * 3], events[idx * 3 + 1], events[idx * 3 + 2], samplePositions[idx])) break;
+	}
+	return idx;
+}
+
+void MidiEventBlock::copyToMidiBuffer(MidiBuffer& buffer) const
+{
+	for (int idx = 0; idx < numEvents; ++idx) {
+		const uint8 bytes[3] = { status[idx], data1[idx], data2[idx] };
+		buffer.addEvent(bytes, MidiMessage::getMessageLengthFromFirstByte(status[idx]), samplePosition[idx]);
+	}
+}
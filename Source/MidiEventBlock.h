@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// A MidiBuffer stores a 6-byte header (position and size) before the bytes of every event
+#define MIDI_BUFFER_EVENT_HEADER_SIZE 6
+
+// A preallocated block of short (up to 3 bytes) MIDI events, stored as one array per field
+// so that routing can work on whole blocks with tight loops over plain bytes.
+// Events must be added in time order; nothing is allocated after construction.
+class MidiEventBlock
+{
+public:
+	MidiEventBlock(int capacity);
+	~MidiEventBlock();
+
+	void clear();
+	// Keeps the first newSize events
+	void truncate(int newSize);
+	int size() const;
+	int getCapacity() const;
+
+	// Returns false (and drops the event) when the block is full
+	bool addEvent(uint8 status, uint8 data1, uint8 data2, int samplePosition, int port = 0, int transpose = 0);
+	// Overwrites the event at toIdx with the one at fromIdx, to compact the block in place
+	void copyEvent(int fromIdx, int toIdx);
+
+	// Short events of the buffer are added to the block, the longer ones (SysEx) to longMessages
+	// while they fit in longMessageBytesLeft (counting the MidiBuffer header of every event).
+	// Stops when the block is full: the iterator is then left at the first event not added.
+	// Returns the number of long messages that did not fit, which are dropped.
+	int addFromMidiBuffer(MidiBuffer::Iterator& iter, MidiBuffer& longMessages, int& longMessageBytesLeft);
+	// Returns the number of events added, less than numEvents when the block is full
+	int addFromRawEvents(const uint8* events, const int* samplePositions, int numEvents);
+	void copyToMidiBuffer(MidiBuffer& buffer) const;
+
+	HeapBlock<uint8> status;
+	HeapBlock<uint8> data1;
+	HeapBlock<uint8> data2;
+	HeapBlock<int> samplePosition;
+	HeapBlock<int> port;
+	// Semitones still to be added to the note number of note events, 0 for the others
+	HeapBlock<int> transpose;
+
+private:
+	int numEvents = 0;
+	int capacity;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiEventBlock)
+};
@@ -0,0 +1,174 @@
+#include <JuceHeader.h>
+#include "MidiOutputSender.h"
+
+MidiOutputSender::MidiOutputSender(MidiBackend& b, const String& deviceName) : Thread("MIDI Output Sender"), backend(b), deviceName(deviceName), fifo(SENDER_QUEUE_SIZE), queue(SENDER_QUEUE_SIZE)
+{
+	startThread(SENDER_THREAD_PRIORITY);
+}
+
+MidiOutputSender::~MidiOutputSender()
+{
+	signalThreadShouldExit();
+	messagesAvailable.signal();
+	stopThread(SENDER_WAIT_TIMEOUT_MS * 10);
+}
+
+void MidiOutputSender::run()
+{
+	while (!threadShouldExit()) {
+		// Only the first message of an empty queue signals
+		if (!hasPendingMessages()) messagesAvailable.wait(SENDER_WAIT_TIMEOUT_MS);
+		updateDevice();
+		sendPendingMessages();
+	}
+}
+
+bool MidiOutputSender::openDevice(const String& name)
+{
+	std::shared_ptr<MidiBackend::Output> newDevice(name.isNotEmpty() ? backend.openOutput(name) : nullptr);
+	{
+		const ScopedLock sl(nameLock);
+		if (newDevice != nullptr) deviceName = name;
+		isDeviceStale = false;
+		hasOpenFailed = false;
+	}
+	const ScopedLock sl(deviceLock);
+	device = newDevice;
+	return device != nullptr;
+}
+
+void MidiOutputSender::setDevice(const String& name)
+{
+	{
+		const ScopedLock sl(nameLock);
+		deviceName = name;
+		isDeviceStale = true;
+		hasOpenFailed = false;
+	}
+	messagesAvailable.signal();
+}
+
+void MidiOutputSender::deviceConnected()
+{
+	const ScopedLock sl(nameLock);
+	hasOpenFailed = false;
+}
+
+void MidiOutputSender::deviceDisconnected()
+{
+	{
+		const ScopedLock sl(nameLock);
+		isDeviceStale = true;
+		hasOpenFailed = false;
+	}
+	messagesAvailable.signal();
+}
+
+bool MidiOutputSender::isOpen()
+{
+	const ScopedLock sl(deviceLock);
+	return device != nullptr;
+}
+
+String MidiOutputSender::getDeviceName()
+{
+	const ScopedLock sl(nameLock);
+	return deviceName;
+}
+
+bool MidiOutputSender::enqueueMessage(const MidiMessage& message)
+{
+	const bool isNoteRelease = message.isNoteOff() || message.isAllNotesOff();
+	int numPending;
+	{
+		const SpinLock::ScopedLockType sl(writeLock);
+		if (fifo.getFreeSpace() <= (isNoteRelease ? 0 : SENDER_RESERVED_SLOTS)) {
+			if (!isNoteRelease) return false; // Queue full, the message is dropped
+			pendingAllNotesOff.fetch_or(1u << (message.getChannel() - 1));
+			messagesAvailable.signal();
+			return true;
+		}
+		int start1, size1, start2, size2;
+		fifo.prepareToWrite(1, start1, size1, start2, size2);
+		queue[size1 > 0 ? start1 : start2] = message;
+		fifo.finishedWrite(1);
+		numPending = fifo.getNumReady();
+	}
+	if (numPending > highWaterMark.load(std::memory_order_relaxed)) highWaterMark.store(numPending, std::memory_order_relaxed);
+	// The sender thread does not wait while the queue is not empty
+	if (numPending == 1) messagesAvailable.signal();
+	return true;
+}
+
+int MidiOutputSender::getNumPendingMessages()
+{
+	return fifo.getNumReady();
+}
+
+int MidiOutputSender::getHighWaterMark()
+{
+	return highWaterMark.load(std::memory_order_relaxed);
+}
+
+void MidiOutputSender::resetHighWaterMark()
+{
+	highWaterMark.store(0, std::memory_order_relaxed);
+}
+
+void MidiOutputSender::updateDevice()
+{
+	String name;
+	bool isStale, hasFailed;
+	{
+		const ScopedLock sl(nameLock);
+		name = deviceName;
+		isStale = isDeviceStale;
+		hasFailed = hasOpenFailed;
+		isDeviceStale = false;
+	}
+	if (isStale) {
+		const ScopedLock sl(deviceLock);
+		device.reset();
+	}
+	// Lazy opening: nothing to do until there is something to send
+	if (isOpen() || hasFailed || name.isEmpty() || fifo.getNumReady() == 0) return;
+
+	// Opening can take long: no lock is held, so that the other threads never wait for it
+	std::shared_ptr<MidiBackend::Output> newDevice(backend.openOutput(name));
+	{
+		const ScopedLock sl(nameLock);
+		// The device may have been changed meanwhile, then it is opened again at the next message
+		if (isDeviceStale || name != deviceName) return;
+		hasOpenFailed = newDevice == nullptr;
+	}
+	const ScopedLock sl(deviceLock);
+	device = newDevice;
+}
+
+void MidiOutputSender::sendPendingMessages()
+{
+	std::shared_ptr<MidiBackend::Output> currentDevice;
+	{
+		const ScopedLock sl(deviceLock);
+		currentDevice = device;
+	}
+	int start1, size1, start2, size2;
+	fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+	if (currentDevice != nullptr) {
+		for (int idx = start1; idx < start1 + size1; ++idx) currentDevice->sendMessageNow(queue[idx]);
+		for (int idx = start2; idx < start2 + size2; ++idx) currentDevice->sendMessageNow(queue[idx]);
+	}
+	fifo.finishedRead(size1 + size2);
+
+	// The Note Offs that did not fit in the queue
+	const uint32 channels = pendingAllNotesOff.exchange(0);
+	if (channels == 0 || currentDevice == nullptr) return;
+	for (int channel = 1; channel <= 16; ++channel) {
+		if ((channels & (1u << (channel - 1))) != 0) currentDevice->sendMessageNow(MidiMessage::allNotesOff(channel));
+	}
+}
+
+bool MidiOutputSender::hasPendingMessages()
+{
+	return fifo.getNumReady() > 0 || pendingAllNotesOff.load() != 0;
+}
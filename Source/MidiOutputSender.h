@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiBackend.h"
+
+#define SENDER_QUEUE_SIZE 1024
+#define SENDER_THREAD_PRIORITY 9
+#define SENDER_WAIT_TIMEOUT_MS 100
+// The last slots of the queue only take Note Offs and All Notes Off, so that a full queue
+// never leaves a note hanging
+#define SENDER_RESERVED_SLOTS 64
+
+// Owns a single MIDI output port and drains a queue of messages on its own thread,
+// so that a slow or blocked port cannot delay the others.
+class MidiOutputSender    : public Thread
+{
+public:
+	MidiOutputSender(MidiBackend& backend, const String& deviceName = String());
+	~MidiOutputSender();
+
+	void run() override;
+
+	// An empty name closes the device
+	bool openDevice(const String& name);
+	// Never blocks: the device is opened by the sender thread when the first message comes.
+	// If it cannot be opened, the messages are dropped until deviceConnected().
+	void setDevice(const String& name);
+	// Hotplug notifications: a connected device is retried at the next message,
+	// a disconnected one is closed and opened again on its return
+	void deviceConnected();
+	void deviceDisconnected();
+	bool isOpen();
+	String getDeviceName();
+
+	// Can be called from any thread, never blocks on the device. A Note Off or an All Notes
+	// Off that finds the queue full becomes an All Notes Off on its channel, sent after the
+	// queued messages, and is never dropped.
+	bool enqueueMessage(const MidiMessage& message);
+	int getNumPendingMessages();
+	// Largest number of queued messages since the last reset
+	int getHighWaterMark();
+	void resetHighWaterMark();
+
+private:
+	void updateDevice();
+	void sendPendingMessages();
+	bool hasPendingMessages();
+
+	MidiBackend& backend;
+	// Only held to take or replace the pointer: the device is used without the lock,
+	// so that a stalled port never blocks the threads asking for its state
+	std::shared_ptr<MidiBackend::Output> device;
+	CriticalSection deviceLock;
+	// The name of the device and what the sender thread must do with it
+	CriticalSection nameLock;
+	String deviceName;
+	bool isDeviceStale = false;
+	bool hasOpenFailed = false;
+
+	// Message queue (multiple producers, the sender thread is the only consumer)
+	AbstractFifo fifo;
+	std::vector<MidiMessage> queue;
+	SpinLock writeLock;
+	WaitableEvent messagesAvailable;
+	std::atomic<int> highWaterMark { 0 };
+	// One bit per channel (1 << (channel - 1)) that needs an All Notes Off
+	std::atomic<uint32> pendingAllNotesOff { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputSender)
+};
@@ -0,0 +1,176 @@
+#include <JuceHeader.h>
+#include "OscEndpoint.h"
+
+OscEndpoint::OscEndpoint() : Thread("OSC Sender"), fifo(OSC_QUEUE_SIZE), queue(OSC_QUEUE_SIZE)
+{
+}
+
+OscEndpoint::~OscEndpoint()
+{
+	stop();
+}
+
+void OscEndpoint::run()
+{
+	while (!threadShouldExit()) {
+		if (!eventsAvailable.wait(OSC_WAIT_TIMEOUT_MS)) continue;
+		// The events that follow the first one within the window go in the same bundle
+		wait(OSC_BATCH_INTERVAL_MS);
+		sendPendingEvents();
+	}
+}
+
+bool OscEndpoint::start(const String& host, int sendPort, int receivePort)
+{
+	stop();
+	if (!sender.connect(host, sendPort)) return false;
+	if (!receiver.connect(receivePort)) {
+		sender.disconnect();
+		return false;
+	}
+	receiver.addListener(this);
+	{
+		const SpinLock::ScopedLockType sl(writeLock);
+		fifo.reset();
+	}
+	isSending = true;
+	startThread();
+	return true;
+}
+
+void OscEndpoint::stop()
+{
+	isSending = false;
+	signalThreadShouldExit();
+	eventsAvailable.signal();
+	stopThread(OSC_THREAD_STOP_TIMEOUT_MS);
+	receiver.removeListener(this);
+	receiver.disconnect();
+	sender.disconnect();
+}
+
+bool OscEndpoint::isActive()
+{
+	return isSending.load();
+}
+
+void OscEndpoint::setMirrorRoutedMessages(bool shouldMirror)
+{
+	isMirroring = shouldMirror;
+}
+
+void OscEndpoint::setSongNames(const StringArray& names)
+{
+	const ScopedLock sl(songNamesLock);
+	songNames = names;
+}
+
+void OscEndpoint::publishSetlistSwitch(int fileIdx)
+{
+	enqueueEvent({ setlistSwitch, fileIdx, 0, MidiMessage() });
+}
+
+void OscEndpoint::publishSongMessage(const MidiMessage& message, int port)
+{
+	enqueueEvent({ songMessage, 0, port, message });
+}
+
+void OscEndpoint::publishRoutedMessage(const MidiMessage& message, int port)
+{
+	// Routed messages are short messages: a longer one would allocate when queued
+	if (!isMirroring.load(std::memory_order_relaxed) || message.getRawDataSize() > 3) return;
+	enqueueEvent({ routedMessage, 0, port, message });
+}
+
+int OscEndpoint::getNumDropped()
+{
+	return numDropped.load(std::memory_order_relaxed);
+}
+
+void OscEndpoint::enqueueEvent(const Event& event)
+{
+	if (!isSending.load(std::memory_order_relaxed)) return;
+	const SpinLock::ScopedLockType sl(writeLock);
+	int start1, size1, start2, size2;
+	fifo.prepareToWrite(1, start1, size1, start2, size2);
+	if (size1 + size2 == 0) {
+		// Queue full, the event is dropped
+		numDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	queue[size1 > 0 ? start1 : start2] = event;
+	fifo.finishedWrite(1);
+	eventsAvailable.signal();
+}
+
+void OscEndpoint::sendPendingEvents()
+{
+	int start1, size1, start2, size2;
+	fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+	OSCBundle bundle;
+	auto addEvents = [this, &bundle](int start, int size) {
+		for (int idx = start; idx < start + size; ++idx) {
+			addEventToBundle(queue[idx], bundle);
+			if (bundle.size() >= OSC_MAX_BUNDLE_ELEMENTS) {
+				sender.send(bundle);
+				bundle = OSCBundle();
+			}
+		}
+	};
+	addEvents(start1, size1);
+	addEvents(start2, size2);
+	fifo.finishedRead(size1 + size2);
+	// Nobody listening is not an error for UDP, a failed send is simply lost
+	if (!bundle.isEmpty()) sender.send(bundle);
+}
+
+void OscEndpoint::addEventToBundle(const Event& event, OSCBundle& bundle)
+{
+	const MidiMessage& message = event.message;
+	switch (event.type) {
+	case setlistSwitch: {
+		String name;
+		{
+			const ScopedLock sl(songNamesLock);
+			name = songNames[event.fileIdx];
+		}
+		bundle.addElement(OSCMessage(OSCAddressPattern(OSC_SONG_ADDRESS), event.fileIdx, name));
+		break;
+	}
+	case songMessage:
+		if (message.isProgramChange())
+			bundle.addElement(OSCMessage(OSCAddressPattern(OSC_PROGRAM_CHANGE_ADDRESS), event.port, message.getChannel(), message.getProgramChangeNumber()));
+		else if (message.isController())
+			bundle.addElement(OSCMessage(OSCAddressPattern(OSC_BANK_SELECT_ADDRESS), event.port, message.getChannel(), message.getControllerValue()));
+		break;
+	case routedMessage: {
+		const uint8* data = message.getRawData();
+		const int size = message.getRawDataSize();
+		bundle.addElement(OSCMessage(OSCAddressPattern(OSC_ROUTED_ADDRESS), event.port, (int)data[0], size > 1 ? (int)data[1] : 0, size > 2 ? (int)data[2] : 0));
+		break;
+	}
+	}
+}
+
+void OscEndpoint::oscMessageReceived(const OSCMessage& message)
+{
+	const String address = message.getAddressPattern().toString();
+	if (address == OSC_NEXT_ADDRESS) sendActionMessage("remoteNextFile");
+	else if (address == OSC_PREVIOUS_ADDRESS) sendActionMessage("remotePreviousFile");
+	else if (address == OSC_JUMP_ADDRESS && message.size() > 0) {
+		// Some peers can only send floats
+		const OSCArgument& argument = message[0];
+		int fileIdx = -1;
+		if (argument.isInt32()) fileIdx = argument.getInt32();
+		else if (argument.isFloat32()) fileIdx = roundToInt(argument.getFloat32());
+		if (fileIdx >= 0) sendActionMessage("remoteSelectFile" + String(fileIdx));
+	}
+}
+
+void OscEndpoint::oscBundleReceived(const OSCBundle& bundle)
+{
+	for (auto& element : bundle) {
+		if (element.isMessage()) oscMessageReceived(element.getMessage());
+		else if (element.isBundle()) oscBundleReceived(element.getBundle());
+	}
+}
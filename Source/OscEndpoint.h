@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#define OSC_DEFAULT_HOST "127.0.0.1"
+#define OSC_DEFAULT_SEND_PORT 9001
+#define OSC_DEFAULT_RECEIVE_PORT 9000
+#define OSC_QUEUE_SIZE 4096
+// Events published within this time go in the same bundle
+#define OSC_BATCH_INTERVAL_MS 5
+#define OSC_WAIT_TIMEOUT_MS 100
+// Keeps every bundle well inside a single UDP datagram
+#define OSC_MAX_BUNDLE_ELEMENTS 64
+#define OSC_THREAD_STOP_TIMEOUT_MS 1000
+
+#define OSC_SONG_ADDRESS "/zonifier/song"
+#define OSC_PROGRAM_CHANGE_ADDRESS "/zonifier/programChange"
+#define OSC_BANK_SELECT_ADDRESS "/zonifier/bankSelect"
+#define OSC_ROUTED_ADDRESS "/zonifier/routed"
+#define OSC_NEXT_ADDRESS "/zonifier/next"
+#define OSC_PREVIOUS_ADDRESS "/zonifier/previous"
+#define OSC_JUMP_ADDRESS "/zonifier/jump"
+
+// Optional OSC over UDP endpoint for the other processes of the show (lights, click tracks).
+// Published, in bundles gathering the events of a few milliseconds:
+//   /zonifier/song <index> <name>                       setlist switch
+//   /zonifier/programChange <port> <channel> <program>  sent by the selected song
+//   /zonifier/bankSelect <port> <channel> <bank>        sent by the selected song
+//   /zonifier/routed <port> <status> <data1> <data2>    every routed message, if mirrored
+// Accepted: /zonifier/next, /zonifier/previous and /zonifier/jump <index>, which are
+// announced with the action messages "remoteNextFile", "remotePreviousFile" and
+// "remoteSelectFile<index>" on the message thread.
+// The publishing functions only queue the event: the socket is written by this thread.
+class OscEndpoint : public Thread, public ActionBroadcaster,
+	private OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>
+{
+public:
+	OscEndpoint();
+	~OscEndpoint();
+
+	void run() override;
+
+	// Called from the message thread
+	bool start(const String& host = OSC_DEFAULT_HOST, int sendPort = OSC_DEFAULT_SEND_PORT, int receivePort = OSC_DEFAULT_RECEIVE_PORT);
+	void stop();
+	bool isActive();
+	void setMirrorRoutedMessages(bool shouldMirror);
+	void setSongNames(const StringArray& names);
+	void publishSetlistSwitch(int fileIdx);
+	// The Bank Selects and Program Changes of a selected song
+	void publishSongMessage(const MidiMessage& message, int port);
+
+	// Can be called from the MIDI threads, does nothing unless the endpoint is active and mirroring
+	void publishRoutedMessage(const MidiMessage& message, int port);
+
+	// Events that did not fit in the queue
+	int getNumDropped();
+
+private:
+	enum EventType { setlistSwitch, songMessage, routedMessage };
+
+	struct Event
+	{
+		EventType type;
+		int fileIdx;
+		int port;
+		MidiMessage message;
+	};
+
+	void enqueueEvent(const Event& event);
+	void sendPendingEvents();
+	void addEventToBundle(const Event& event, OSCBundle& bundle);
+
+	void oscMessageReceived(const OSCMessage& message) override;
+	void oscBundleReceived(const OSCBundle& bundle) override;
+
+	OSCSender sender;
+	OSCReceiver receiver;
+	std::atomic<bool> isSending { false };
+	std::atomic<bool> isMirroring { false };
+	std::atomic<int> numDropped { 0 };
+
+	// Song names for the setlist switches, read by the sender thread
+	CriticalSection songNamesLock;
+	StringArray songNames;
+
+	// Event queue (multiple producers, the sender thread is the only consumer)
+	AbstractFifo fifo;
+	std::vector<Event> queue;
+	SpinLock writeLock;
+	WaitableEvent eventsAvailable;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscEndpoint)
+};
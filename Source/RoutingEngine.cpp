@@ -0,0 +1,179 @@
+#include <JuceHeader.h>
+#include "RoutingEngine.h"
+
+RoutingEngine::RoutingEngine(IOComponent& i, MidiDeviceWatcher& w, Setlist& s, TrafficCounters& c, Listener& l)
+	: io(i), watcher(w), setlist(s), counters(c), listener(l), arpeggiatorOutput(*this), arpeggiator(arpeggiatorOutput)
+{
+	router.setArpeggiator(&arpeggiator);
+}
+
+RoutingEngine::~RoutingEngine()
+{
+	// No callback may run once the sources are deleted
+	watcher.closeAllInputs();
+	router.setArpeggiator(nullptr);
+}
+
+void RoutingEngine::addInputSource(const String& name)
+{
+	const int id = getInputSourceId(name);
+	if (id == ANY_INPUT_SOURCE) return;
+	// The watcher opens the input in the background, and again whenever the device is plugged back
+	for (auto source : inputSources) {
+		if (source->name == name) {
+			watcher.enableInput(name, source);
+			return;
+		}
+	}
+	watcher.enableInput(name, inputSources.add(new InputSource(*this, id, name)));
+}
+
+// The source is kept: the watcher thread may still be using it until it closes the input
+void RoutingEngine::removeInputSource(const String& name)
+{
+	watcher.disableInput(name);
+}
+
+void RoutingEngine::setlistLoaded()
+{
+	auto configurations = setlist.getConfigurations();
+	resolveInputSources(configurations);
+	resolveOutputPorts(configurations);
+	router.setConfigurations(std::move(configurations));
+	StringArray songNames;
+	for (int fileIdx = 0; fileIdx < setlist.getNumFiles(); ++fileIdx) songNames.add(setlist.getFileName(fileIdx));
+	osc.setSongNames(songNames);
+	selectSong(setlist.getCurrentFileIdx());
+}
+
+void RoutingEngine::ccMappingLoaded()
+{
+	auto mapping = setlist.getCCMapping();
+	for (auto& device : mapping.devices) {
+		device.sourceId = getInputSourceId(device.inDevice);
+		for (auto& targets : device.targets) {
+			for (auto& target : targets) {
+				target.outPort = io.getMidiOutputPort(target.outDevice);
+			}
+		}
+	}
+	Setlist::compileDeviceOfSource(mapping);
+	router.setCCMapping(std::move(mapping));
+}
+
+void RoutingEngine::changeSong(int fileIdx)
+{
+	io.sendNoteOffToAll();
+	selectSong(fileIdx);
+}
+
+void RoutingEngine::selectSong(int fileIdx)
+{
+	recorder.recordSetlistSwitch(fileIdx);
+	osc.publishSetlistSwitch(fileIdx);
+	IOOutput output(*this);
+	output.isSongSelection = true;
+	router.selectConfiguration(fileIdx, output);
+}
+
+SessionRecorder& RoutingEngine::getRecorder()
+{
+	return recorder;
+}
+
+OscEndpoint& RoutingEngine::getOsc()
+{
+	return osc;
+}
+
+Arpeggiator& RoutingEngine::getArpeggiator()
+{
+	return arpeggiator;
+}
+
+StringArray RoutingEngine::getInputSourceNames()
+{
+	return inputSourceNames;
+}
+
+void RoutingEngine::InputSource::handleIncomingMidiMessage(MidiInput* /*source*/, const MidiMessage& message)
+{
+	owner.recorder.recordInput(message, id);
+	owner.counters.countInput(message, id);
+	owner.arpeggiator.handleSyncMessage(message, message.getTimeStamp());
+	IOOutput output(owner, this);
+	owner.router.processMidiMessage(message, output, id);
+	// Notes outside of every zone and CCs without a mapping
+	if (output.numRouted == 0 && (message.isNoteOnOrOff() || message.isController()))
+		owner.counters.countFiltered();
+}
+
+void RoutingEngine::IOOutput::routeMidiMessage(const MidiMessage& message, int port)
+{
+	const bool isQueued = owner.io.sendMIDIMessage(message, port);
+	if (isQueued) {
+		owner.recorder.recordOutput(message, port);
+		owner.counters.countOutput(message, port);
+	}
+	else {
+		owner.recorder.recordDroppedOutput(message, port);
+		owner.counters.countDropped();
+	}
+	// Only queued, the socket is written by the OSC thread
+	if (isSongSelection) owner.osc.publishSongMessage(message, port);
+	else owner.osc.publishRoutedMessage(message, port);
+	++numRouted;
+	owner.listener.messageRouted(message, port, isQueued, source != nullptr ? source->name : String());
+}
+
+void RoutingEngine::IOOutput::songChangeRequested(int delta)
+{
+	owner.listener.songChangeRequested(delta);
+}
+
+// Numbers a device the first time it is enabled or named by an "inDevice" of the loaded files,
+// so that a device keeps its tables when it is enabled after the files are loaded
+int RoutingEngine::getInputSourceId(const String& name)
+{
+	if (name.isEmpty()) return ANY_INPUT_SOURCE;
+	if (!inputSourceNames.contains(name)) {
+		if (inputSourceNames.size() >= MAX_INPUT_SOURCES) return ANY_INPUT_SOURCE;
+		inputSourceNames.add(name);
+		recorder.setSourceName(inputSourceNames.size() - 1, name);
+		listener.inputSourcesChanged(inputSourceNames);
+	}
+	return inputSourceNames.indexOf(name);
+}
+
+// Turns the optional "inDevice" names of the loaded files into input source ids, so that
+// the MIDI thread finds the zones of a device by index
+void RoutingEngine::resolveInputSources(std::vector<ZoneConfiguration>& configurations)
+{
+	for (auto& configuration : configurations) {
+		for (auto& device : configuration.devices) {
+			device.sourceId = getInputSourceId(device.inDevice);
+		}
+		Setlist::compileDeviceOfSource(configuration);
+	}
+}
+
+// Turns the optional "outDevice" names of the loaded files into output port indices,
+// so that the MIDI thread never has to look up a device by name
+void RoutingEngine::resolveOutputPorts(std::vector<ZoneConfiguration>& configurations)
+{
+	for (auto& configuration : configurations) {
+		for (auto& device : configuration.devices) {
+			for (auto& zones : device.zones) {
+				for (auto& zone : zones) {
+					zone.outPort = io.getMidiOutputPort(zone.outDevice);
+				}
+			}
+		}
+		for (auto& pc : configuration.programChanges) {
+			pc.outPort = io.getMidiOutputPort(pc.outDevice);
+		}
+		for (auto& bs : configuration.bankSelects) {
+			bs.outPort = io.getMidiOutputPort(bs.outDevice);
+		}
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "IOComponent.h"
+#include "MidiDeviceWatcher.h"
+#include "Setlist.h"
+#include "ZoneRouter.h"
+#include "Arpeggiator.h"
+#include "SessionRecorder.h"
+#include "OscEndpoint.h"
+#include "TrafficCounters.h"
+
+// The MIDI path of the application without its windows: every enabled input gets a source
+// that routes its messages, and the routed messages go to the output ports of the IOComponent,
+// the session recorder, the traffic counters and the OSC mirror. The application runs it on
+// the devices of the system, the loopback harness of the tools on loopback devices.
+// Its owner loads the setlist and decides what a song change does.
+class RoutingEngine
+{
+public:
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+		// Called from the MIDI threads and the arpeggiator thread for every message given to an
+		// output port; sourceName is empty for the messages not routed from an input
+		virtual void messageRouted(const MidiMessage& message, int port, bool isQueued, const String& sourceName) {}
+		// Program Changes 0 and 1, from a MIDI thread: the owner moves in the setlist, then calls changeSong()
+		virtual void songChangeRequested(int delta) = 0;
+		// On the message thread, when a device gets its source id
+		virtual void inputSourcesChanged(const StringArray& sourceNames) {}
+	};
+
+	RoutingEngine(IOComponent& io, MidiDeviceWatcher& watcher, Setlist& setlist, TrafficCounters& counters, Listener& listener);
+	~RoutingEngine();
+
+	// These are called from the message thread
+	void addInputSource(const String& name);
+	void removeInputSource(const String& name);
+	// Resolves the devices of the loaded files and selects the current one
+	void setlistLoaded();
+	void ccMappingLoaded();
+	// Silences every output, then selects a file
+	void changeSong(int fileIdx);
+	// Sends the Bank Selects and Program Changes of a file, and tells the recorder and the OSC peers
+	void selectSong(int fileIdx);
+
+	SessionRecorder& getRecorder();
+	OscEndpoint& getOsc();
+	Arpeggiator& getArpeggiator();
+	StringArray getInputSourceNames();
+
+private:
+	// Every enabled MIDI input gets its own callback, which knows the id of the source
+	// (stable for the whole session) without looking at the device name for every event
+	class InputSource : public MidiInputCallback
+	{
+	public:
+		InputSource(RoutingEngine& o, int i, const String& n)
+			: owner(o), id(i), name(n)
+		{}
+
+		void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
+
+		RoutingEngine& owner;
+		const int id;
+		const String name;
+	};
+
+	// Sends the routed messages to the MIDI outputs and tells the consumers
+	class IOOutput : public ZoneRouter::Output
+	{
+	public:
+		IOOutput(RoutingEngine& o, InputSource* s = nullptr)
+			: owner(o), source(s)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+		void songChangeRequested(int delta) override;
+
+		RoutingEngine& owner;
+		InputSource* source;
+		int numRouted = 0;
+		// The Bank Selects and Program Changes of a selected file
+		bool isSongSelection = false;
+	};
+
+	int getInputSourceId(const String& name);
+	void resolveInputSources(std::vector<ZoneConfiguration>& configurations);
+	void resolveOutputPorts(std::vector<ZoneConfiguration>& configurations);
+
+	IOComponent& io;
+	MidiDeviceWatcher& watcher;
+	Setlist& setlist;
+	TrafficCounters& counters;
+	Listener& listener;
+
+	// Zones, Harmony and CC Management
+	ZoneRouter router;
+
+	// MIDI Inputs (ids are indices in inputSourceNames, sources live until the watcher has closed them)
+	StringArray inputSourceNames;
+	OwnedArray<InputSource> inputSources;
+
+	SessionRecorder recorder;
+	// Before the arpeggiator, whose output publishes to it
+	OscEndpoint osc;
+
+	// Arpeggiated zones (after everything their output uses)
+	IOOutput arpeggiatorOutput;
+	Arpeggiator arpeggiator;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RoutingEngine)
+};
@@ -0,0 +1,171 @@
+#include <JuceHeader.h>
+#include "SessionRecorder.h"
+
+static_assert(sizeof(SessionRecorder::Record) == 16, "Session records must stay 16 bytes");
+static_assert(sizeof(SessionRecorder::Header) == 64, "The session header must stay 64 bytes");
+
+SessionRecorder::SessionRecorder() : Thread("Session Recorder")
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+	stopThread(SESSION_RECORDER_STOP_TIMEOUT_MS);
+	if (isRecording) header->numRecords = numRecords.load();
+	isRecording = false;
+}
+
+void SessionRecorder::startInBackground(const File& newLogFile, int capacity)
+{
+	if (isThreadRunning() || isRecording) return;
+	{
+		const ScopedLock sl(lock);
+		logFile = newLogFile;
+	}
+	backgroundCapacity = capacity;
+	startThread();
+}
+
+void SessionRecorder::run()
+{
+	start(getLogFile(), backgroundCapacity);
+}
+
+bool SessionRecorder::start(const File& newLogFile, int capacity)
+{
+	if (isRecording) return false;
+	const int64 fileSize = (int64)sizeof(Header) + SESSION_SOURCE_NAME_SIZE * MAX_INPUT_SOURCES + (int64)sizeof(Record) * capacity;
+	// Preallocate the whole file before mapping it, with zeros: a file with only its last byte
+	// written is sparse, and its blocks would be allocated by the MIDI threads while recording
+	newLogFile.deleteFile();
+	{
+		FileOutputStream stream(newLogFile);
+		if (!stream.openedOk()) return false;
+		HeapBlock<uint8> zeros(SESSION_LOG_WRITE_CHUNK_SIZE, true);
+		for (int64 written = 0; written < fileSize; written += SESSION_LOG_WRITE_CHUNK_SIZE) {
+			if (threadShouldExit()) return false;
+			if (!stream.write(zeros, (size_t)jmin((int64)SESSION_LOG_WRITE_CHUNK_SIZE, fileSize - written))) return false;
+		}
+		stream.flush();
+		if (stream.getStatus().failed()) return false;
+	}
+	mappedFile.reset(new MemoryMappedFile(newLogFile, MemoryMappedFile::readWrite));
+	if (mappedFile->getData() == nullptr || (int64)mappedFile->getSize() < fileSize) {
+		mappedFile.reset();
+		return false;
+	}
+	// Fault every page in now rather than at the first record written to it
+	volatile uint8* data = static_cast<uint8*>(mappedFile->getData());
+	for (int64 offset = 0; offset < fileSize; offset += 4096) data[offset] = 0;
+	header = static_cast<Header*>(mappedFile->getData());
+	sourceNames = reinterpret_cast<char*>(header + 1);
+	records = reinterpret_cast<Record*>(sourceNames + SESSION_SOURCE_NAME_SIZE * MAX_INPUT_SOURCES);
+	memcpy(header->magic, SESSION_LOG_MAGIC, 4);
+	header->version = SESSION_LOG_VERSION;
+	header->ticksPerSecond = Time::getHighResolutionTicksPerSecond();
+	header->capacity = (uint64)capacity;
+	header->numRecords = 0;
+	numRecords = 0;
+	{
+		// The names given before the start
+		const ScopedLock sl(lock);
+		logFile = newLogFile;
+		for (int sourceId = 0; sourceId < MAX_INPUT_SOURCES; ++sourceId) writeSourceName(sourceId);
+		isRecording = true;
+	}
+	return true;
+}
+
+File SessionRecorder::getLogFile()
+{
+	const ScopedLock sl(lock);
+	return logFile;
+}
+
+void SessionRecorder::setSourceName(int sourceId, const String& name)
+{
+	if (sourceId < 0 || sourceId >= MAX_INPUT_SOURCES) return;
+	const ScopedLock sl(lock);
+	pendingSourceNames[sourceId] = name;
+	if (isRecording) writeSourceName(sourceId);
+}
+
+void SessionRecorder::writeSourceName(int sourceId)
+{
+	// Cut to the entry, always leaving the terminating zero
+	pendingSourceNames[sourceId].copyToUTF8(sourceNames + SESSION_SOURCE_NAME_SIZE * sourceId, SESSION_SOURCE_NAME_SIZE);
+}
+
+void SessionRecorder::recordInput(const MidiMessage& message, int sourceId)
+{
+	record(inputEvent, (uint8)sourceId, message.getRawData(), message.getRawDataSize());
+}
+
+void SessionRecorder::recordOutput(const MidiMessage& message, int port)
+{
+	record(outputEvent, (uint8)port, message.getRawData(), message.getRawDataSize());
+}
+
+void SessionRecorder::recordDroppedOutput(const MidiMessage& message, int port)
+{
+	record(droppedOutputEvent, (uint8)port, message.getRawData(), message.getRawDataSize());
+}
+
+void SessionRecorder::recordSetlistSwitch(int fileIdx)
+{
+	const uint8 data[2] = { (uint8)(fileIdx & 0xFF), (uint8)((fileIdx >> 8) & 0xFF) };
+	record(setlistSwitch, 0, data, 2);
+}
+
+void SessionRecorder::record(uint8 type, uint8 source, const uint8* data, int size)
+{
+	if (!isRecording) return;
+	const uint64 recordIdx = numRecords.fetch_add(1);
+	Record& newRecord = records[recordIdx % header->capacity];
+	// The type marks the record as complete: cleared first, written back last
+	newRecord.type = incompleteRecord;
+	std::atomic_thread_fence(std::memory_order_release);
+	newRecord.ticks = Time::getHighResolutionTicks();
+	newRecord.source = source;
+	newRecord.size = (uint8)jmin(size, 255);
+	memcpy(newRecord.data, data, (size_t)jmin(size, RECORD_DATA_SIZE));
+	std::atomic_thread_fence(std::memory_order_release);
+	newRecord.type = type;
+}
+
+bool SessionRecorder::readLog(const File& logFile, Header& header, StringArray& sourceNames, std::vector<Record>& records)
+{
+	FileInputStream stream(logFile);
+	if (!stream.openedOk() || stream.read(&header, sizeof(Header)) != (int)sizeof(Header)) return false;
+	if (memcmp(header.magic, SESSION_LOG_MAGIC, 4) != 0 || header.version < SESSION_LOG_FIRST_VERSION || header.version > SESSION_LOG_VERSION) return false;
+	sourceNames.clear();
+	if (header.version >= 2) {
+		char name[SESSION_SOURCE_NAME_SIZE];
+		for (int sourceId = 0; sourceId < MAX_INPUT_SOURCES; ++sourceId) {
+			if (stream.read(name, SESSION_SOURCE_NAME_SIZE) != SESSION_SOURCE_NAME_SIZE) return false;
+			name[SESSION_SOURCE_NAME_SIZE - 1] = 0;
+			sourceNames.add(String::fromUTF8(name));
+		}
+	}
+	// Since version 3 the whole ring is read, the slots never written have no type
+	const uint64 numRecords = header.version >= 3 ? header.capacity : jmin(header.numRecords, header.capacity);
+	records.resize((size_t)numRecords);
+	if (stream.read(records.data(), (int)(numRecords * sizeof(Record))) != (int)(numRecords * sizeof(Record))) return false;
+	records.erase(std::remove_if(records.begin(), records.end(), [](const Record& record) { return record.type == incompleteRecord; }), records.end());
+	// The ring starts at the oldest record; records written at the same time by different threads are sorted by time
+	std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return a.ticks < b.ticks; });
+	return true;
+}
+
+int SessionRecorder::getSetlistSwitchFileIdx(const Record& record)
+{
+	return record.data[0] | (record.data[1] << 8);
+}
+
+void SessionRecorder::removeOldLogs(const File& folder, int numKept)
+{
+	StringArray logPaths;
+	for (auto& log : folder.findChildFiles(File::findFiles, false, SESSION_LOG_PATTERN)) logPaths.add(log.getFullPathName());
+	logPaths.sort(false);
+	for (int idx = 0; idx < logPaths.size() - numKept; ++idx) File(logPaths[idx]).deleteFile();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Setlist.h"
+
+#define SESSION_LOG_MAGIC "MZSR"
+#define SESSION_LOG_VERSION 3
+// Version 1 logs have no table of input source names; before version 3, numRecords is written
+// with every record and incomplete records cannot be told apart
+#define SESSION_LOG_FIRST_VERSION 1
+// Bytes of every entry of the source name table (UTF-8, zero-terminated)
+#define SESSION_SOURCE_NAME_SIZE 64
+#define DEFAULT_SESSION_RECORDS (1 << 20)
+#define RECORD_DATA_SIZE 5
+#define SESSION_LOG_PATTERN "session_*.mzlog"
+// Logs kept in the sessions folder, the oldest ones are deleted
+#define MAX_SESSION_LOGS 20
+#define SESSION_LOG_WRITE_CHUNK_SIZE 65536
+#define SESSION_RECORDER_STOP_TIMEOUT_MS 5000
+
+// Always-on recorder of a session: every input event, output event and setlist switch is
+// appended to a preallocated memory-mapped file, so that a gig can be analysed and replayed.
+// The file is a ring of fixed-size records: when it is full the oldest records are overwritten.
+// Between the header and the records, a table gives the name of every input source id, so that
+// the replay finds the zones of each device. The type of a record is written last, so that a
+// record cut by a crash is left without a type and skipped when the log is read.
+class SessionRecorder    : private Thread
+{
+public:
+	enum RecordType
+	{
+		incompleteRecord = 0, // Never written, or being written when the session stopped
+		inputEvent = 1,
+		outputEvent = 2,
+		setlistSwitch = 3,
+		droppedOutputEvent = 4 // Routed, but its output queue was full
+	};
+
+	struct Record
+	{
+		int64 ticks; // Time::getHighResolutionTicks()
+		uint8 type;
+		uint8 source; // Input source id, output port, or 0 for setlist switches
+		uint8 size; // MIDI message size (only the first RECORD_DATA_SIZE bytes are kept)
+		uint8 data[RECORD_DATA_SIZE]; // MIDI bytes, or the file index (little endian) for setlist switches
+	};
+
+	struct Header
+	{
+		char magic[4];
+		uint32 version;
+		int64 ticksPerSecond;
+		uint64 capacity;
+		uint64 numRecords; // Ever written, set when the recorder stops (0 after a crash, the records are found by their type)
+		uint8 reserved[32];
+	};
+
+	SessionRecorder();
+	~SessionRecorder();
+
+	// Creates and maps the log file; call before any event is recorded. The file is written
+	// in full and every page of the mapping is touched, so recording never waits for the disk
+	bool start(const File& logFile, int capacity = DEFAULT_SESSION_RECORDS);
+	// Same, from a thread of the recorder so that the caller is not blocked while the file is
+	// written: recording begins once the file is ready, the events before are not recorded
+	void startInBackground(const File& logFile, int capacity = DEFAULT_SESSION_RECORDS);
+	File getLogFile();
+
+	// Called from the message thread when an input source gets its id, before or after the start
+	void setSourceName(int sourceId, const String& name);
+
+	// Lock-free and allocation-free: can be called from the MIDI and audio threads
+	void recordInput(const MidiMessage& message, int sourceId);
+	// Called once the message is queued, or not: a dropped message was never sent
+	void recordOutput(const MidiMessage& message, int port);
+	void recordDroppedOutput(const MidiMessage& message, int port);
+	void recordSetlistSwitch(int fileIdx);
+
+	// Reads back a log, records in time order
+	// sourceNames[id] is the name of the input source id, empty for the unknown ones
+	static bool readLog(const File& logFile, Header& header, StringArray& sourceNames, std::vector<Record>& records);
+	static int getSetlistSwitchFileIdx(const Record& record);
+	// Deletes all but the newest numKept logs of the folder (names sort by date)
+	static void removeOldLogs(const File& folder, int numKept = MAX_SESSION_LOGS);
+
+private:
+	void run() override;
+	void record(uint8 type, uint8 source, const uint8* data, int size);
+	void writeSourceName(int sourceId);
+
+	File logFile;
+	int backgroundCapacity = DEFAULT_SESSION_RECORDS;
+	// Set once the mapping is ready, the recording threads do not touch it before
+	std::atomic<bool> isRecording {false};
+	// Kept out of the mapping: the file is not shared by other processes, only read back
+	std::atomic<uint64> numRecords {0};
+	// Protects the names and the log file, which are set by different threads before the start
+	CriticalSection lock;
+	String pendingSourceNames[MAX_INPUT_SOURCES];
+	std::unique_ptr<MemoryMappedFile> mappedFile;
+	Header* header = nullptr;
+	char* sourceNames = nullptr;
+	Record* records = nullptr;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionRecorder)
+};
@@ -0,0 +1,183 @@
+#include <JuceHeader.h>
+#include "Setlist.h"
+#include "SetlistParser.h"
+
+Setlist::Setlist()
+{
+}
+
+Setlist::~Setlist()
+{
+}
+
+bool Setlist::loadDirectory(const File& folder) {
+	std::vector<ZoneConfiguration> newConfigurations;
+	std::vector<String> newFileNames;
+	loadErrors.clear();
+	DirectoryIterator iter(folder, false, "*.json", File::findFiles);
+	while (iter.next()) {
+		FileInputStream inputStream(iter.getFile());
+		if (!inputStream.openedOk()) continue;
+		try {
+			newConfigurations.push_back(SetlistParser::parseZoneConfiguration(inputStream));
+			newFileNames.push_back(iter.getFile().getFileNameWithoutExtension());
+		}
+		catch (const SetlistParser::Error& e) {
+			loadErrors.add(iter.getFile().getFileName() + ", " + e.what());
+			DBG("Skipping " + iter.getFile().getFullPathName() + ": " + e.what());
+		}
+	}
+	if (newConfigurations.empty()) return false;
+	directory = folder;
+	configurations = std::move(newConfigurations);
+	fileNames = std::move(newFileNames);
+	currentFileIdx = 0;
+	return true;
+}
+
+bool Setlist::loadCCMappingFile(const File& file) {
+	loadErrors.clear();
+	FileInputStream inputStream(file);
+	if (!inputStream.openedOk()) return false;
+	try {
+		ccMapping = SetlistParser::parseCCMapping(inputStream);
+	}
+	catch (const SetlistParser::Error& e) {
+		loadErrors.add(file.getFileName() + ", " + e.what());
+		DBG("Cannot load " + file.getFullPathName() + ": " + e.what());
+		return false;
+	}
+	ccMappingFile = file;
+	return true;
+}
+
+bool Setlist::selectFile(int fileIdx) {
+	if (fileIdx < 0 || fileIdx >= (int)configurations.size()) return false;
+	currentFileIdx = fileIdx;
+	return true;
+}
+
+bool Setlist::selectPreviousFile() {
+	return selectFile(currentFileIdx - 1);
+}
+
+bool Setlist::selectNextFile() {
+	return selectFile(currentFileIdx + 1);
+}
+
+int Setlist::getCurrentFileIdx() {
+	return currentFileIdx;
+}
+
+int Setlist::getNumFiles() {
+	return (int)configurations.size();
+}
+
+String Setlist::getFileName(int fileIdx) {
+	return fileNames[fileIdx];
+}
+
+String Setlist::getCurrentFileDescription() {
+	if (configurations.empty()) return "No file loaded...";
+	return "[" + String(currentFileIdx + 1) + "/" + String(getNumFiles()) + "] " + fileNames[currentFileIdx];
+}
+
+File Setlist::getDirectory() {
+	return directory;
+}
+
+File Setlist::getCCMappingFile() {
+	return ccMappingFile;
+}
+
+const std::vector<ZoneConfiguration>& Setlist::getConfigurations() {
+	return configurations;
+}
+
+const CCMapping& Setlist::getCCMapping() {
+	return ccMapping;
+}
+
+const StringArray& Setlist::getLoadErrors() {
+	return loadErrors;
+}
+
+ZoneConfiguration Setlist::createDefaultConfiguration() {
+	// Every input channel goes unchanged to the default output channel
+	Zone zone;
+	zone.startNote = MIN_NOTE_NUMBER;
+	zone.endNote = MAX_NOTE_NUMBER;
+	zone.outChannel = DEFAULT_OUT_CHANNEL;
+	zone.transpose = 0;
+	zone.outPort = DEFAULT_OUTPUT_PORT;
+	zone.hasHarmony = false;
+	zone.harmonyIndex.fill(NO_HARMONY);
+	zone.hasArpeggiator = false;
+	zone.arpeggiatorSlot = 0;
+	compileVelocityTable(zone, VelocitySettings());
+
+	ZoneConfiguration configuration;
+	for (int channel = 1; channel <= NUM_MIDI_CHANNELS; ++channel) {
+		configuration.devices[ANY_DEVICE_INPUT].zones[channel].push_back(zone);
+	}
+	compileNoteZoneTables(configuration);
+	return configuration;
+}
+
+void Setlist::compileNoteZoneTables(ZoneConfiguration& configuration) {
+	for (auto& device : configuration.devices) {
+		for (int channel = 0; channel <= NUM_MIDI_CHANNELS; ++channel) {
+			NoteZoneTable& table = device.noteZoneTables[channel];
+			const std::vector<Zone>& zones = device.zones[channel];
+			table.zoneIndices.clear();
+			for (int note = MIN_NOTE_NUMBER; note <= MAX_NOTE_NUMBER; ++note) {
+				table.start[note] = (uint16)table.zoneIndices.size();
+				for (int zoneIdx = 0; zoneIdx < (int)zones.size(); ++zoneIdx) {
+					if (zones[zoneIdx].startNote <= note && note <= zones[zoneIdx].endNote) table.zoneIndices.push_back((uint16)zoneIdx);
+				}
+			}
+			table.start[NUM_MIDI_NOTES] = (uint16)table.zoneIndices.size();
+		}
+	}
+}
+
+void Setlist::compileDeviceOfSource(ZoneConfiguration& configuration) {
+	configuration.deviceOfSource.fill(ANY_DEVICE_INPUT);
+	for (int deviceIdx = 0; deviceIdx < (int)configuration.devices.size(); ++deviceIdx) {
+		const int sourceId = configuration.devices[deviceIdx].sourceId;
+		if (deviceIdx != ANY_DEVICE_INPUT && sourceId >= 0 && sourceId < MAX_INPUT_SOURCES) configuration.deviceOfSource[sourceId] = (uint8)deviceIdx;
+	}
+}
+
+void Setlist::compileDeviceOfSource(CCMapping& mapping) {
+	mapping.deviceOfSource.fill(ANY_DEVICE_INPUT);
+	for (int deviceIdx = 0; deviceIdx < (int)mapping.devices.size(); ++deviceIdx) {
+		const int sourceId = mapping.devices[deviceIdx].sourceId;
+		if (deviceIdx != ANY_DEVICE_INPUT && sourceId >= 0 && sourceId < MAX_INPUT_SOURCES) mapping.deviceOfSource[sourceId] = (uint8)deviceIdx;
+	}
+}
+
+void Setlist::compileVelocityTable(Zone& zone, const VelocitySettings& settings) {
+	const int minVelocity = settings.minVelocity;
+	const int maxVelocity = settings.maxVelocity;
+	const double velocityCurve = settings.velocityCurve;
+	const double velocityScale = settings.velocityScale;
+	const int fixedVelocity = settings.fixedVelocity;
+
+	zone.hasVelocityRange = minVelocity > MIN_VELOCITY || maxVelocity < MAX_VELOCITY;
+	zone.activeNotes.fill(false);
+	zone.velocityTable[0] = OUT_OF_VELOCITY_RANGE;
+	for (int velocity = MIN_VELOCITY; velocity <= MAX_VELOCITY; ++velocity) {
+		if (velocity < minVelocity || velocity > maxVelocity) {
+			zone.velocityTable[velocity] = OUT_OF_VELOCITY_RANGE;
+		}
+		else if (fixedVelocity > 0) {
+			zone.velocityTable[velocity] = (uint8)jlimit(MIN_VELOCITY, MAX_VELOCITY, fixedVelocity);
+		}
+		else {
+			// Curve > 1 is softer, < 1 is harder, then the result is scaled
+			double curved = std::pow(velocity / (double)MAX_VELOCITY, velocityCurve) * MAX_VELOCITY * velocityScale;
+			zone.velocityTable[velocity] = (uint8)jlimit(MIN_VELOCITY, MAX_VELOCITY, roundToInt(curved));
+		}
+	}
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#define NUM_MIDI_CHANNELS 16
+#define NUM_MIDI_NOTES 128
+#define NUM_MIDI_CCS 128
+#define NO_HARMONY -1
+
+#define MIN_NOTE_NUMBER 0
+#define MAX_NOTE_NUMBER 127
+#define DEFAULT_OUT_CHANNEL 1
+#define DEFAULT_OUTPUT_PORT 0
+#define MIN_VELOCITY 1
+#define MAX_VELOCITY 127
+#define OUT_OF_VELOCITY_RANGE 0
+// Beyond these, a zone cannot play any note or any useful velocity
+#define MAX_TRANSPOSE (MAX_NOTE_NUMBER - MIN_NOTE_NUMBER)
+#define MIN_VELOCITY_CURVE 0.1
+#define MAX_VELOCITY_CURVE 10.0
+#define MIN_VELOCITY_SCALE 0.1
+#define MAX_VELOCITY_SCALE 10.0
+
+// Input sources are the MIDI input devices, numbered when they are registered
+#define MAX_INPUT_SOURCES 255
+#define ANY_INPUT_SOURCE -1
+// Index of the tables of the inputs without "inDevice", used by every device without its own
+#define ANY_DEVICE_INPUT 0
+
+// Arpeggiated zones of a configuration, each one has its own pattern
+#define MAX_ARPEGGIATORS 16
+#define MAX_ARPEGGIATOR_OCTAVES 4
+#define MAX_ARPEGGIATOR_DIVISION 64
+
+// Arpeggiator options of a zone, as written in the file
+struct ArpeggiatorSettings
+{
+	enum Mode { upMode, downMode, upDownMode, randomMode, asPlayedMode, repeatMode };
+
+	int mode = upMode;
+	int octaves = 1;
+	// Steps per whole note: 4 plays quarter notes, 16 sixteenths, 12 eighth-note triplets
+	int division = 16;
+	// Length of the notes, as a fraction of the step
+	double gate = 0.5;
+	// Delay of the odd steps, as a fraction of the step (0 - 0.5)
+	double swing = 0.0;
+};
+
+// Compiled structures of the configuration files, built once at load time so that
+// routing never looks anything up by string
+
+struct Zone
+{
+	int startNote;
+	int endNote;
+	int outChannel;
+	int transpose;
+	String outDevice;
+	int outPort;
+
+	// Harmony: for every input note, the index in harmonies or NO_HARMONY
+	bool hasHarmony;
+	std::array<int, NUM_MIDI_NOTES> harmonyIndex;
+	std::vector<std::vector<int>> harmonies;
+
+	// Velocity: output velocity for every Note On velocity, OUT_OF_VELOCITY_RANGE if the
+	// zone does not play it. With a range, the zone remembers which notes it is playing,
+	// so that their Note Offs are routed where the Note Ons went.
+	std::array<uint8, NUM_MIDI_NOTES> velocityTable;
+	bool hasVelocityRange;
+	std::array<bool, NUM_MIDI_NOTES> activeNotes;
+
+	// Arpeggiator: the zone gives its notes (or the ones of its harmonies) to the pattern
+	// of its slot instead of playing them
+	bool hasArpeggiator;
+	int arpeggiatorSlot;
+	ArpeggiatorSettings arpeggiator;
+};
+
+// Velocity options of a zone, as written in the file
+struct VelocitySettings
+{
+	int minVelocity = MIN_VELOCITY;
+	int maxVelocity = MAX_VELOCITY;
+	double velocityCurve = 1.0;
+	double velocityScale = 1.0;
+	int fixedVelocity = 0;
+};
+
+struct ProgramChange
+{
+	int outChannel;
+	int programChangeNumber;
+	String outDevice;
+	int outPort;
+};
+
+struct BankSelect
+{
+	int outChannel;
+	int bankNumber;
+	String outDevice;
+	int outPort;
+};
+
+// The zones of one input channel that contain each note, in file order:
+// for note n they are zoneIndices[start[n]] ... zoneIndices[start[n + 1] - 1]
+struct NoteZoneTable
+{
+	std::array<uint16, NUM_MIDI_NOTES + 1> start;
+	std::vector<uint16> zoneIndices;
+};
+
+// The zones of one input device, indexed by input channel (1-16). A device with its own
+// zones gets the ones of any device for the channels it does not list.
+struct DeviceZones
+{
+	String inDevice;
+	int sourceId = ANY_INPUT_SOURCE;
+	std::array<std::vector<Zone>, NUM_MIDI_CHANNELS + 1> zones;
+	std::array<NoteZoneTable, NUM_MIDI_CHANNELS + 1> noteZoneTables;
+};
+
+struct ZoneConfiguration
+{
+	// devices[ANY_DEVICE_INPUT] has the zones of the inputs without "inDevice"
+	std::vector<DeviceZones> devices = std::vector<DeviceZones>(1);
+	// Index in devices for every input source id, ANY_DEVICE_INPUT by default
+	std::array<uint8, MAX_INPUT_SOURCES> deviceOfSource {};
+	std::vector<ProgramChange> programChanges;
+	std::vector<BankSelect> bankSelects;
+};
+
+struct CCTarget
+{
+	int outCC;
+	int outChannel;
+	String outDevice;
+	int outPort;
+};
+
+// The CC mapping of one input device, indexed by input CC number. A device with its own
+// entries gets the ones of any device for the CCs it does not map.
+struct DeviceCCTargets
+{
+	String inDevice;
+	int sourceId = ANY_INPUT_SOURCE;
+	std::array<std::vector<CCTarget>, NUM_MIDI_CCS> targets;
+};
+
+struct CCMapping
+{
+	String keyboardName;
+	// devices[ANY_DEVICE_INPUT] has the entries without "inDevice"
+	std::vector<DeviceCCTargets> devices = std::vector<DeviceCCTargets>(1);
+	// Index in devices for every input source id, ANY_DEVICE_INPUT by default
+	std::array<uint8, MAX_INPUT_SOURCES> deviceOfSource {};
+};
+
+// The zone configurations of a directory and the CC mapping, independent of any GUI
+class Setlist
+{
+public:
+	Setlist();
+	~Setlist();
+
+	bool loadDirectory(const File& folder);
+	bool loadCCMappingFile(const File& file);
+
+	bool selectFile(int fileIdx);
+	bool selectPreviousFile();
+	bool selectNextFile();
+
+	int getCurrentFileIdx();
+	int getNumFiles();
+	String getFileName(int fileIdx);
+	String getCurrentFileDescription();
+	File getDirectory();
+	File getCCMappingFile();
+
+	const std::vector<ZoneConfiguration>& getConfigurations();
+	const CCMapping& getCCMapping();
+	// The files skipped by the last load, with the reason
+	const StringArray& getLoadErrors();
+
+	static ZoneConfiguration createDefaultConfiguration();
+
+	// Used by the parser once the fields of a zone and of a configuration are read
+	static void compileVelocityTable(Zone& zone, const VelocitySettings& settings);
+	static void compileNoteZoneTables(ZoneConfiguration& configuration);
+	// Once the "inDevice" names have a source id, every id is given the tables of its device
+	static void compileDeviceOfSource(ZoneConfiguration& configuration);
+	static void compileDeviceOfSource(CCMapping& mapping);
+
+private:
+	File directory;
+	std::vector<ZoneConfiguration> configurations;
+	std::vector<String> fileNames;
+	int currentFileIdx = 0;
+
+	File ccMappingFile;
+	CCMapping ccMapping;
+
+	StringArray loadErrors;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Setlist)
+};
@@ -0,0 +1,751 @@
+#include <JuceHeader.h>
+#include "SetlistParser.h"
+#include "../ExternalLib/json.hpp"
+
+using json = nlohmann::json;
+
+//==============================================================================
+// Feeds the parser from an InputStream, and knows the line and column of what it read
+class InputStreamBuffer : public std::streambuf
+{
+public:
+	InputStreamBuffer(InputStream& s)
+		: stream(s)
+	{}
+
+	// Of the last character given to the parser
+	void getPosition(int& line, int& column) const
+	{
+		line = bufferLine;
+		column = bufferColumn;
+		advancePosition(eback(), gptr(), line, column);
+		column = jmax(1, column - 1);
+	}
+
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		advancePosition(eback(), egptr(), bufferLine, bufferColumn);
+		setg(buffer, buffer, buffer);
+		const int numRead = stream.read(buffer, PARSER_BUFFER_SIZE);
+		if (numRead <= 0) return traits_type::eof();
+		setg(buffer, buffer, buffer + numRead);
+		return traits_type::to_int_type(*gptr());
+	}
+
+private:
+	static void advancePosition(const char* start, const char* end, int& line, int& column)
+	{
+		for (const char* c = start; c < end; ++c) {
+			if (*c == '\n') {
+				++line;
+				column = 1;
+			}
+			else ++column;
+		}
+	}
+
+	InputStream& stream;
+	char buffer[PARSER_BUFFER_SIZE];
+	// Position of the start of the buffer
+	int bufferLine = 1;
+	int bufferColumn = 1;
+};
+
+//==============================================================================
+// Keeps track of the object and array being parsed; the file handlers give a meaning
+// (a context) to every container from its parent and its key, and receive the values
+class SetlistSaxHandler : public nlohmann::json_sax<json>
+{
+public:
+	// Containers the handlers do not know about are skipped with all their content;
+	// failedContext is returned after fail()
+	enum { ignoredContext = -1, failedContext = -2 };
+
+	SetlistSaxHandler(InputStreamBuffer& b)
+		: buffer(b)
+	{}
+
+	bool null() override { return otherValue("null"); }
+	bool boolean(bool) override { return otherValue("a boolean"); }
+	bool number_integer(number_integer_t value) override { return numberValue((double)value, true); }
+	bool number_unsigned(number_unsigned_t value) override { return numberValue((double)value, true); }
+	bool number_float(number_float_t value, const string_t&) override { return numberValue((double)value, false); }
+	bool string(string_t& value) override
+	{
+		if (containers.empty()) return fail("The file must contain an object");
+		return isIgnored() || !isKnownKey(getContext(), getKey()) || onString(getContext(), getKey(), String(value));
+	}
+
+#if NLOHMANN_JSON_VERSION_MAJOR > 3 || (NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR >= 8)
+	bool binary(binary_t&) override { return otherValue("a binary value"); }
+#endif
+
+	bool start_object(std::size_t) override
+	{
+		int context = isIgnored() ? (int)ignoredContext : enterObject(getContext(), getKey());
+		if (context == failedContext) return false;
+		containers.push_back({ context, true });
+		currentKey.clear();
+		return true;
+	}
+
+	bool start_array(std::size_t) override
+	{
+		if (containers.empty()) return fail("The file must contain an object");
+		int context = isIgnored() ? (int)ignoredContext : enterArray(getContext(), getKey());
+		if (context == failedContext) return false;
+		containers.push_back({ context, false });
+		return true;
+	}
+
+	bool key(string_t& newKey) override
+	{
+		currentKey = newKey;
+		return true;
+	}
+
+	bool end_object() override { return endContainer(); }
+	bool end_array() override { return endContainer(); }
+
+	// The message of the library starts with its own position ("parse error at line 2, column 5: "),
+	// which is dropped: Error gives the one of the buffer
+	bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+	{
+		const String message(ex.what());
+		const String description = message.fromFirstOccurrenceOf(": ", false, false);
+		return fail(description.isNotEmpty() ? description : message);
+	}
+
+	void throwIfFailed(bool parsed)
+	{
+		if (parsed) return;
+		if (errorMessage.isEmpty()) fail("Unexpected end of file");
+		throw SetlistParser::Error(errorMessage, errorLine, errorColumn);
+	}
+
+protected:
+	// Return the context of the new container, ignoredContext or failedContext.
+	// The file itself is an object whose parent context is ignoredContext.
+	virtual int enterObject(int parentContext, const std::string& parentKey) = 0;
+	virtual int enterArray(int parentContext, const std::string& parentKey) = 0;
+	// Called at the end of every known container; return false after fail()
+	virtual bool leave(int context) = 0;
+	// Values of unknown keys are skipped whatever their type
+	virtual bool isKnownKey(int context, const std::string& key) = 0;
+	// The key is empty for the values of an array; isInteger is false for numbers written
+	// with a fraction or an exponent
+	virtual bool onNumber(int context, const std::string& key, double value, bool isInteger) = 0;
+	virtual bool onString(int context, const std::string& key, const String& value) = 0;
+
+	bool fail(const String& message)
+	{
+		if (errorMessage.isEmpty()) {
+			errorMessage = message;
+			buffer.getPosition(errorLine, errorColumn);
+		}
+		return false;
+	}
+
+	bool failWrongType(const std::string& valueKey, const String& expected)
+	{
+		if (valueKey.empty()) return fail("The array must contain " + expected);
+		return fail("\"" + String(valueKey) + "\" must be " + expected);
+	}
+
+	bool failMissing(const char* valueKey, const char* container)
+	{
+		return fail("Missing \"" + String(valueKey) + "\" in " + String(container));
+	}
+
+	// MIDI values out of their range are errors, rather than being clamped or skipped
+	bool checkRange(const std::string& valueKey, double value, int minValue, int maxValue)
+	{
+		if (value >= minValue && value <= maxValue) return true;
+		return fail("\"" + String(valueKey) + "\" must be between " + String(minValue) + " and " + String(maxValue));
+	}
+
+	bool checkRange(const std::string& valueKey, double value, double minValue, double maxValue)
+	{
+		if (value >= minValue && value <= maxValue) return true;
+		return fail("\"" + String(valueKey) + "\" must be between " + String(minValue, 1) + " and " + String(maxValue, 1));
+	}
+
+	// Likewise, the fraction of an integer field is an error rather than being truncated
+	bool checkInteger(const std::string& valueKey, bool isInteger)
+	{
+		if (isInteger) return true;
+		return fail("\"" + String(valueKey) + "\" must be an integer");
+	}
+
+	static bool isOneOf(const std::string& k, std::initializer_list<const char*> keys)
+	{
+		for (const char* candidate : keys) {
+			if (k == candidate) return true;
+		}
+		return false;
+	}
+
+private:
+	struct Container
+	{
+		int context;
+		bool isObject;
+	};
+
+	bool isIgnored() const { return !containers.empty() && containers.back().context == ignoredContext; }
+	int getContext() const { return containers.empty() ? (int)ignoredContext : containers.back().context; }
+	const std::string& getKey() const
+	{
+		static const std::string noKey;
+		return !containers.empty() && containers.back().isObject ? currentKey : noKey;
+	}
+
+	bool numberValue(double value, bool isInteger)
+	{
+		if (containers.empty()) return fail("The file must contain an object");
+		return isIgnored() || !isKnownKey(getContext(), getKey()) || onNumber(getContext(), getKey(), value, isInteger);
+	}
+
+	// No known value can be null or a boolean
+	bool otherValue(const String& description)
+	{
+		if (containers.empty()) return fail("The file must contain an object");
+		if (isIgnored() || !isKnownKey(getContext(), getKey())) return true;
+		if (getKey().empty()) return fail("Unexpected " + description + " in an array");
+		return fail("\"" + String(getKey()) + "\" cannot be " + description);
+	}
+
+	bool endContainer()
+	{
+		const int context = containers.back().context;
+		containers.pop_back();
+		currentKey.clear();
+		return context == ignoredContext || leave(context);
+	}
+
+	InputStreamBuffer& buffer;
+	std::vector<Container> containers;
+	std::string currentKey;
+
+	String errorMessage;
+	int errorLine = 0;
+	int errorColumn = 0;
+};
+
+//==============================================================================
+// Index of the tables of an input device, added on first use; the inputs without "inDevice"
+// share ANY_DEVICE_INPUT. Returns -1 when the device cannot be indexed by an uint8.
+template <typename DeviceTables>
+static int getDeviceIdx(std::vector<DeviceTables>& devices, const String& inDevice)
+{
+	if (inDevice.isEmpty()) return ANY_DEVICE_INPUT;
+	for (int deviceIdx = 0; deviceIdx < (int)devices.size(); ++deviceIdx) {
+		if (deviceIdx != ANY_DEVICE_INPUT && devices[deviceIdx].inDevice == inDevice) return deviceIdx;
+	}
+	if (devices.size() > 0xFF) return -1;
+	devices.emplace_back();
+	devices.back().inDevice = inDevice;
+	return (int)devices.size() - 1;
+}
+
+//==============================================================================
+class ZoneConfigurationHandler : public SetlistSaxHandler
+{
+public:
+	ZoneConfigurationHandler(InputStreamBuffer& b)
+		: SetlistSaxHandler(b)
+	{}
+
+	ZoneConfiguration configuration;
+
+protected:
+	enum Context
+	{
+		rootContext,
+		inputListContext,
+		inputContext,
+		zoneListContext,
+		zoneContext,
+		harmonyListContext,
+		harmonyContext,
+		outNotesContext,
+		arpeggiatorContext,
+		programChangeListContext,
+		programChangeContext,
+		bankSelectListContext,
+		bankSelectContext
+	};
+
+	// Required fields seen in the current object
+	enum RootField
+	{
+		zoneListField = 1,
+		programChangeListField = 2,
+		bankSelectListField = 4
+	};
+
+	enum InputField
+	{
+		inChannelField = 1,
+		inputZonesField = 2
+	};
+
+	enum ZoneField
+	{
+		startNoteField = 1,
+		endNoteField = 2,
+		zoneOutChannelField = 4,
+		transposeField = 8
+	};
+
+	enum HarmonyField
+	{
+		inNoteField = 1,
+		outNotesField = 2
+	};
+
+	// Program Change and Bank Select
+	enum MessageField
+	{
+		messageOutChannelField = 1,
+		messageNumberField = 2
+	};
+
+	int enterObject(int parentContext, const std::string& parentKey) override
+	{
+		switch (parentContext) {
+		case ignoredContext:
+			return rootContext;
+		case rootContext:
+			if (parentKey != "zones" && parentKey != "programChanges" && parentKey != "bankSelects") return ignoredContext;
+			failWrongType(parentKey, "an array");
+			return failedContext;
+		case inputContext:
+			if (parentKey != "zones") return ignoredContext;
+			failWrongType(parentKey, "an array");
+			return failedContext;
+		case harmonyContext:
+			if (parentKey != "outNotes") return ignoredContext;
+			failWrongType(parentKey, "an array");
+			return failedContext;
+		case zoneContext:
+			if (parentKey == "harmony") {
+				failWrongType(parentKey, "an array");
+				return failedContext;
+			}
+			if (parentKey != "arpeggiator") return ignoredContext;
+			zone.hasArpeggiator = true;
+			zone.arpeggiator = ArpeggiatorSettings();
+			return arpeggiatorContext;
+		case inputListContext:
+			inChannel = 0;
+			inDevice = String();
+			inputFields = 0;
+			inputZones.clear();
+			return inputContext;
+		case zoneListContext:
+			zone = Zone();
+			zone.outPort = DEFAULT_OUTPUT_PORT;
+			zone.hasHarmony = false;
+			zone.harmonyIndex.fill(NO_HARMONY);
+			zone.hasArpeggiator = false;
+			zone.arpeggiatorSlot = 0;
+			velocity = VelocitySettings();
+			zoneFields = 0;
+			return zoneContext;
+		case harmonyListContext:
+			inNote = 0;
+			harmonyFields = 0;
+			outNotes.clear();
+			return harmonyContext;
+		case programChangeListContext:
+		case bankSelectListContext:
+			outChannel = 0;
+			number = 0;
+			outDevice = String();
+			messageFields = 0;
+			return parentContext == programChangeListContext ? programChangeContext : bankSelectContext;
+		case outNotesContext:
+			failWrongType(std::string(), "numbers");
+			return failedContext;
+		default:
+			return ignoredContext;
+		}
+	}
+
+	int enterArray(int parentContext, const std::string& parentKey) override
+	{
+		if (parentContext == rootContext && parentKey == "zones") { rootFields |= zoneListField; return inputListContext; }
+		if (parentContext == rootContext && parentKey == "programChanges") { rootFields |= programChangeListField; return programChangeListContext; }
+		if (parentContext == rootContext && parentKey == "bankSelects") { rootFields |= bankSelectListField; return bankSelectListContext; }
+		if (parentContext == inputContext && parentKey == "zones") { inputFields |= inputZonesField; return zoneListContext; }
+		if (parentContext == zoneContext && parentKey == "harmony") { zone.hasHarmony = true; return harmonyListContext; }
+		if (parentContext == harmonyContext && parentKey == "outNotes") { harmonyFields |= outNotesField; return outNotesContext; }
+		if (parentContext == zoneContext && parentKey == "arpeggiator") {
+			failWrongType(parentKey, "an object");
+			return failedContext;
+		}
+		if (parentKey.empty()) {
+			failWrongType(parentKey, parentContext == outNotesContext ? "numbers" : "objects");
+			return failedContext;
+		}
+		return ignoredContext;
+	}
+
+	bool isKnownKey(int context, const std::string& k) override
+	{
+		switch (context) {
+		case rootContext: return isOneOf(k, { "zones", "programChanges", "bankSelects" });
+		case inputContext: return isOneOf(k, { "inChannel", "inDevice", "zones" });
+		case zoneContext: return isOneOf(k, { "startNote", "endNote", "outChannel", "transpose", "outDevice", "harmony",
+			"minVelocity", "maxVelocity", "velocityCurve", "velocityScale", "fixedVelocity", "arpeggiator" });
+		case arpeggiatorContext: return isOneOf(k, { "mode", "octaves", "division", "gate", "swing" });
+		case harmonyContext: return isOneOf(k, { "inNote", "outNotes" });
+		case programChangeContext: return isOneOf(k, { "outChannel", "programChangeNumber", "outDevice" });
+		case bankSelectContext: return isOneOf(k, { "outChannel", "bankNumber", "outDevice" });
+		default: return true; // Values of arrays
+		}
+	}
+
+	// Range of the integer fields, false for the other ones
+	static bool getRange(int context, const std::string& k, int& minValue, int& maxValue)
+	{
+		if (k == "transpose") { minValue = -MAX_TRANSPOSE; maxValue = MAX_TRANSPOSE; return true; }
+		if (k == "inChannel" || k == "outChannel") { minValue = 1; maxValue = NUM_MIDI_CHANNELS; return true; }
+		if (k == "startNote" || k == "endNote" || k == "inNote" || context == outNotesContext) { minValue = MIN_NOTE_NUMBER; maxValue = MAX_NOTE_NUMBER; return true; }
+		if (k == "minVelocity" || k == "maxVelocity") { minValue = MIN_VELOCITY; maxValue = MAX_VELOCITY; return true; }
+		if (k == "fixedVelocity") { minValue = 0; maxValue = MAX_VELOCITY; return true; }
+		if (k == "programChangeNumber" || k == "bankNumber") { minValue = 0; maxValue = 127; return true; }
+		return false;
+	}
+
+	bool onNumber(int context, const std::string& k, double value, bool isInteger) override
+	{
+		const int intValue = (int)value;
+		const std::string valueKey = context == outNotesContext ? "outNotes" : k;
+		int minValue, maxValue;
+		const bool hasRange = getRange(context, k, minValue, maxValue);
+		// The arpeggiator clamps its octaves and division
+		if ((hasRange || (context == arpeggiatorContext && (k == "octaves" || k == "division"))) && !checkInteger(valueKey, isInteger)) return false;
+		if (hasRange && !checkRange(valueKey, value, minValue, maxValue)) return false;
+		if (context == zoneContext) {
+			if (k == "velocityCurve" && !checkRange(k, value, MIN_VELOCITY_CURVE, MAX_VELOCITY_CURVE)) return false;
+			if (k == "velocityScale" && !checkRange(k, value, MIN_VELOCITY_SCALE, MAX_VELOCITY_SCALE)) return false;
+			if (k == "startNote") { zone.startNote = intValue; zoneFields |= startNoteField; }
+			else if (k == "endNote") { zone.endNote = intValue; zoneFields |= endNoteField; }
+			else if (k == "outChannel") { zone.outChannel = intValue; zoneFields |= zoneOutChannelField; }
+			else if (k == "transpose") { zone.transpose = intValue; zoneFields |= transposeField; }
+			else if (k == "minVelocity") velocity.minVelocity = intValue;
+			else if (k == "maxVelocity") velocity.maxVelocity = intValue;
+			else if (k == "velocityCurve") velocity.velocityCurve = value;
+			else if (k == "velocityScale") velocity.velocityScale = value;
+			else if (k == "fixedVelocity") velocity.fixedVelocity = intValue;
+			else return failWrongType(k, k == "harmony" ? "an array" : (k == "arpeggiator" ? "an object" : "a string"));
+			return true;
+		}
+		if (context == arpeggiatorContext) {
+			if (k == "octaves") zone.arpeggiator.octaves = intValue;
+			else if (k == "division") zone.arpeggiator.division = intValue;
+			else if (k == "gate") zone.arpeggiator.gate = value;
+			else if (k == "swing") zone.arpeggiator.swing = value;
+			else return failWrongType(k, "a string");
+			return true;
+		}
+		if (context == inputContext && k == "inChannel") { inChannel = intValue; inputFields |= inChannelField; return true; }
+		if (context == inputContext && k == "inDevice") return failWrongType(k, "a string");
+		if (context == harmonyContext && k == "inNote") { inNote = intValue; harmonyFields |= inNoteField; return true; }
+		if (context == outNotesContext) { outNotes.push_back(intValue); return true; }
+		if (context == programChangeContext || context == bankSelectContext) {
+			if (k == "outChannel") { outChannel = intValue; messageFields |= messageOutChannelField; return true; }
+			if (k == "programChangeNumber" || k == "bankNumber") { number = intValue; messageFields |= messageNumberField; return true; }
+			return failWrongType(k, "a string");
+		}
+		return failWrongType(k, k.empty() ? "objects" : "an array");
+	}
+
+	bool onString(int context, const std::string& k, const String& value) override
+	{
+		if (context == inputContext && k == "inDevice") {
+			inDevice = value;
+			return true;
+		}
+		if (context == arpeggiatorContext && k == "mode") {
+			if (!SetlistParser::parseArpeggiatorMode(value, zone.arpeggiator.mode)) return fail("Unknown arpeggiator mode \"" + value + "\"");
+			return true;
+		}
+		if (context == arpeggiatorContext) return failWrongType(k, "a number");
+		if (context == zoneContext && k == "arpeggiator") return failWrongType(k, "an object");
+		if (k == "outDevice") {
+			if (context == zoneContext) zone.outDevice = value;
+			else outDevice = value;
+			return true;
+		}
+		if (context == rootContext || k.empty() || k == "harmony" || k == "outNotes" || (context == inputContext && k == "zones"))
+			return failWrongType(k, k.empty() ? (context == outNotesContext ? "numbers" : "objects") : "an array");
+		return failWrongType(k, "a number");
+	}
+
+	bool leave(int context) override
+	{
+		switch (context) {
+		case zoneContext:
+			if (!(zoneFields & startNoteField)) return failMissing("startNote", "a zone");
+			if (!(zoneFields & endNoteField)) return failMissing("endNote", "a zone");
+			if (!(zoneFields & zoneOutChannelField)) return failMissing("outChannel", "a zone");
+			if (!(zoneFields & transposeField)) return failMissing("transpose", "a zone");
+			if (zone.startNote > zone.endNote) return fail("\"startNote\" must not be above \"endNote\"");
+			if (velocity.minVelocity > velocity.maxVelocity) return fail("\"minVelocity\" must not be above \"maxVelocity\"");
+			Setlist::compileVelocityTable(zone, velocity);
+			if (zone.hasArpeggiator) {
+				if (numArpeggiators >= MAX_ARPEGGIATORS) return fail("More than " + String(MAX_ARPEGGIATORS) + " arpeggiated zones");
+				zone.arpeggiatorSlot = numArpeggiators++;
+			}
+			inputZones.push_back(std::move(zone));
+			return true;
+		case arpeggiatorContext:
+			zone.arpeggiator.octaves = jlimit(1, MAX_ARPEGGIATOR_OCTAVES, zone.arpeggiator.octaves);
+			zone.arpeggiator.division = jlimit(1, MAX_ARPEGGIATOR_DIVISION, zone.arpeggiator.division);
+			zone.arpeggiator.gate = jlimit(0.01, 1.0, zone.arpeggiator.gate);
+			zone.arpeggiator.swing = jlimit(0.0, 0.5, zone.arpeggiator.swing);
+			return true;
+		case harmonyContext:
+			if (!(harmonyFields & inNoteField)) return failMissing("inNote", "a harmony");
+			if (!(harmonyFields & outNotesField)) return failMissing("outNotes", "a harmony");
+			zone.harmonyIndex[inNote] = (int)zone.harmonies.size();
+			zone.harmonies.push_back(outNotes);
+			return true;
+		case inputContext:
+			if (!(inputFields & inChannelField)) return failMissing("inChannel", "an input");
+			if (!(inputFields & inputZonesField)) return failMissing("zones", "an input");
+			{
+				const int deviceIdx = getDeviceIdx(configuration.devices, inDevice);
+				if (deviceIdx < 0) return fail("Too many input devices");
+				if (deviceIdx >= (int)listedChannels.size()) listedChannels.resize(deviceIdx + 1, std::array<bool, NUM_MIDI_CHANNELS + 1>());
+				listedChannels[deviceIdx][inChannel] = true;
+				for (auto& inputZone : inputZones) configuration.devices[deviceIdx].zones[inChannel].push_back(std::move(inputZone));
+			}
+			return true;
+		case programChangeContext:
+			if (!(messageFields & messageOutChannelField)) return failMissing("outChannel", "a Program Change");
+			if (!(messageFields & messageNumberField)) return failMissing("programChangeNumber", "a Program Change");
+			configuration.programChanges.push_back({ outChannel, number, outDevice, DEFAULT_OUTPUT_PORT });
+			return true;
+		case bankSelectContext:
+			if (!(messageFields & messageOutChannelField)) return failMissing("outChannel", "a Bank Select");
+			if (!(messageFields & messageNumberField)) return failMissing("bankNumber", "a Bank Select");
+			configuration.bankSelects.push_back({ outChannel, number, outDevice, DEFAULT_OUTPUT_PORT });
+			return true;
+		case rootContext:
+			if (!(rootFields & zoneListField)) return failMissing("zones", "the file");
+			if (!(rootFields & programChangeListField)) return failMissing("programChanges", "the file");
+			if (!(rootFields & bankSelectListField)) return failMissing("bankSelects", "the file");
+			// The devices play the zones of any device on the channels they do not list. The copies
+			// keep the arpeggiatorSlot of their zone: it is the same zone, so the keys held on any
+			// of the devices feed one pattern, and the 16 patterns of a file are never exceeded
+			for (int deviceIdx = 0; deviceIdx < (int)configuration.devices.size(); ++deviceIdx) {
+				if (deviceIdx == ANY_DEVICE_INPUT) continue;
+				for (int channel = 1; channel <= NUM_MIDI_CHANNELS; ++channel) {
+					if (!listedChannels[deviceIdx][channel]) configuration.devices[deviceIdx].zones[channel] = configuration.devices[ANY_DEVICE_INPUT].zones[channel];
+				}
+			}
+			Setlist::compileNoteZoneTables(configuration);
+			return true;
+		default:
+			return true;
+		}
+	}
+
+private:
+	int rootFields = 0;
+	int numArpeggiators = 0;
+
+	// Input
+	int inChannel = 0;
+	String inDevice;
+	std::vector<Zone> inputZones;
+	int inputFields = 0;
+	// For every device, the channels that have an input in the file
+	std::vector<std::array<bool, NUM_MIDI_CHANNELS + 1>> listedChannels = std::vector<std::array<bool, NUM_MIDI_CHANNELS + 1>>(1);
+
+	// Zone
+	Zone zone;
+	VelocitySettings velocity;
+	int zoneFields = 0;
+
+	// Harmony
+	int inNote = 0;
+	std::vector<int> outNotes;
+	int harmonyFields = 0;
+
+	// Program Change or Bank Select
+	int outChannel = 0;
+	int number = 0;
+	String outDevice;
+	int messageFields = 0;
+};
+
+//==============================================================================
+class CCMappingHandler : public SetlistSaxHandler
+{
+public:
+	CCMappingHandler(InputStreamBuffer& b)
+		: SetlistSaxHandler(b)
+	{}
+
+	CCMapping mapping;
+
+protected:
+	enum Context
+	{
+		rootContext,
+		mappingListContext,
+		mappingContext
+	};
+
+	enum Field
+	{
+		inCCField = 1,
+		outCCField = 2,
+		outChannelField = 4
+	};
+
+	int enterObject(int parentContext, const std::string& parentKey) override
+	{
+		if (parentContext == ignoredContext) return rootContext;
+		if (parentContext == rootContext && parentKey == "ccMapping") {
+			failWrongType(parentKey, "an array");
+			return failedContext;
+		}
+		if (parentContext == mappingListContext) {
+			inCC = 0;
+			inDevice = String();
+			target = { 0, 0, String(), DEFAULT_OUTPUT_PORT };
+			seenFields = 0;
+			return mappingContext;
+		}
+		return ignoredContext;
+	}
+
+	int enterArray(int parentContext, const std::string& parentKey) override
+	{
+		if (parentContext == rootContext && parentKey == "ccMapping") {
+			hasMappingList = true;
+			return mappingListContext;
+		}
+		if (parentContext == mappingListContext) {
+			failWrongType(parentKey, "objects");
+			return failedContext;
+		}
+		return ignoredContext;
+	}
+
+	bool isKnownKey(int context, const std::string& k) override
+	{
+		if (context == rootContext) return isOneOf(k, { "keyboardName", "ccMapping" });
+		if (context == mappingContext) return isOneOf(k, { "CConKey", "CConVST", "outChannel", "inDevice", "outDevice" });
+		return true;
+	}
+
+	bool onNumber(int context, const std::string& k, double value, bool isInteger) override
+	{
+		if (context == mappingContext) {
+			if ((k == "CConKey" || k == "CConVST" || k == "outChannel") && !checkInteger(k, isInteger)) return false;
+			if ((k == "CConKey" || k == "CConVST") && !checkRange(k, value, 0, NUM_MIDI_CCS - 1)) return false;
+			if (k == "outChannel" && !checkRange(k, value, 1, NUM_MIDI_CHANNELS)) return false;
+			if (k == "CConKey") { inCC = (int)value; seenFields |= inCCField; return true; }
+			if (k == "CConVST") { target.outCC = (int)value; seenFields |= outCCField; return true; }
+			if (k == "outChannel") { target.outChannel = (int)value; seenFields |= outChannelField; return true; }
+		}
+		return failWrongType(k, context == mappingListContext ? "objects" : (k == "ccMapping" ? "an array" : "a string"));
+	}
+
+	bool onString(int context, const std::string& k, const String& value) override
+	{
+		if (context == rootContext && k == "keyboardName") {
+			mapping.keyboardName = value;
+			hasKeyboardName = true;
+			return true;
+		}
+		if (context == mappingContext && k == "inDevice") {
+			inDevice = value;
+			return true;
+		}
+		if (context == mappingContext && k == "outDevice") {
+			target.outDevice = value;
+			return true;
+		}
+		return failWrongType(k, context == mappingListContext ? "objects" : (k == "ccMapping" ? "an array" : "a number"));
+	}
+
+	bool leave(int context) override
+	{
+		if (context == mappingContext) {
+			if (!(seenFields & inCCField)) return failMissing("CConKey", "a CC mapping");
+			if (!(seenFields & outCCField)) return failMissing("CConVST", "a CC mapping");
+			if (!(seenFields & outChannelField)) return failMissing("outChannel", "a CC mapping");
+			const int deviceIdx = getDeviceIdx(mapping.devices, inDevice);
+			if (deviceIdx < 0) return fail("Too many input devices");
+			mapping.devices[deviceIdx].targets[inCC].push_back(target);
+		}
+		else if (context == rootContext) {
+			if (!hasKeyboardName) return failMissing("keyboardName", "the file");
+			if (!hasMappingList) return failMissing("ccMapping", "the file");
+			// The devices use the mapping of any device for the CCs they do not map
+			for (int deviceIdx = 0; deviceIdx < (int)mapping.devices.size(); ++deviceIdx) {
+				if (deviceIdx == ANY_DEVICE_INPUT) continue;
+				for (int cc = 0; cc < NUM_MIDI_CCS; ++cc) {
+					if (mapping.devices[deviceIdx].targets[cc].empty()) mapping.devices[deviceIdx].targets[cc] = mapping.devices[ANY_DEVICE_INPUT].targets[cc];
+				}
+			}
+		}
+		return true;
+	}
+
+private:
+	bool hasKeyboardName = false;
+	bool hasMappingList = false;
+
+	int inCC = 0;
+	String inDevice;
+	CCTarget target;
+	int seenFields = 0;
+};
+
+//==============================================================================
+SetlistParser::Error::Error(const String& message, int l, int c)
+	: std::runtime_error(("line " + String(l) + ", column " + String(c) + ": " + message).toStdString()), line(l), column(c)
+{
+}
+
+ZoneConfiguration SetlistParser::parseZoneConfiguration(InputStream& input)
+{
+	InputStreamBuffer buffer(input);
+	std::istream stream(&buffer);
+	ZoneConfigurationHandler handler(buffer);
+	handler.throwIfFailed(json::sax_parse(stream, &handler));
+	return std::move(handler.configuration);
+}
+
+CCMapping SetlistParser::parseCCMapping(InputStream& input)
+{
+	InputStreamBuffer buffer(input);
+	std::istream stream(&buffer);
+	CCMappingHandler handler(buffer);
+	handler.throwIfFailed(json::sax_parse(stream, &handler));
+	return std::move(handler.mapping);
+}
+
+bool SetlistParser::parseArpeggiatorMode(const String& name, int& mode)
+{
+	// In the order of ArpeggiatorSettings::Mode
+	static const char* const modeNames[] = { "up", "down", "upDown", "random", "asPlayed", "repeat" };
+	for (int idx = 0; idx < numElementsInArray(modeNames); ++idx) {
+		if (name == modeNames[idx]) {
+			mode = idx;
+			return true;
+		}
+	}
+	return false;
+}
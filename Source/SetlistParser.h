@@ -0,0 +1,29 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Setlist.h"
+
+#define PARSER_BUFFER_SIZE 4096
+
+// Reads zone configuration and CC mapping files with a SAX parser, straight into the
+// compiled structures: no JSON document is built, the file is read a block at a time,
+// and errors (syntax or schema) are reported with their line and column
+class SetlistParser
+{
+public:
+	class Error : public std::runtime_error
+	{
+	public:
+		Error(const String& message, int line, int column);
+
+		const int line;
+		const int column;
+	};
+
+	// Both throw Error
+	static ZoneConfiguration parseZoneConfiguration(InputStream& input);
+	static CCMapping parseCCMapping(InputStream& input);
+
+	// The "mode" of an arpeggiator: up, down, upDown, random, asPlayed or repeat
+	static bool parseArpeggiatorMode(const String& name, int& mode);
+};
@@ -0,0 +1,93 @@
+#include <JuceHeader.h>
+#include "TrafficCounters.h"
+
+static_assert(sizeof(std::atomic<uint64>) <= CACHE_LINE_SIZE, "A counter must fit in a cache line");
+
+TrafficCounters::TrafficCounters()
+{
+}
+
+TrafficCounters::~TrafficCounters()
+{
+}
+
+void TrafficCounters::countInput(const MidiMessage& message, int sourceId)
+{
+	if (sourceId >= 0 && sourceId < MAX_COUNTED_SOURCES) {
+		sourceMessages[sourceId].add(1);
+		sourceBytes[sourceId].add((uint64)message.getRawDataSize());
+	}
+	else {
+		otherSourceMessages.add(1);
+		otherSourceBytes.add((uint64)message.getRawDataSize());
+	}
+	if (message.getChannel() > 0) inChannelMessages[message.getChannel() - 1].add(1);
+	typeMessages[getMessageType(message)].add(1);
+}
+
+void TrafficCounters::countOutput(const MidiMessage& message, int port)
+{
+	if (port >= 0 && port < MAX_COUNTED_PORTS) {
+		portMessages[port].add(1);
+		portBytes[port].add((uint64)message.getRawDataSize());
+	}
+	else {
+		otherPortMessages.add(1);
+		otherPortBytes.add((uint64)message.getRawDataSize());
+	}
+	if (message.getChannel() > 0) outChannelMessages[message.getChannel() - 1].add(1);
+}
+
+void TrafficCounters::countDropped()
+{
+	dropped.add(1);
+}
+
+void TrafficCounters::countFiltered()
+{
+	filtered.add(1);
+}
+
+void TrafficCounters::takeSnapshot(Snapshot& snapshot) const
+{
+	for (int idx = 0; idx < MAX_COUNTED_SOURCES; ++idx) {
+		snapshot.sourceMessages[idx] = sourceMessages[idx].get();
+		snapshot.sourceBytes[idx] = sourceBytes[idx].get();
+	}
+	for (int idx = 0; idx < NUM_COUNTED_CHANNELS; ++idx) {
+		snapshot.inChannelMessages[idx] = inChannelMessages[idx].get();
+		snapshot.outChannelMessages[idx] = outChannelMessages[idx].get();
+	}
+	for (int idx = 0; idx < numMessageTypes; ++idx) {
+		snapshot.typeMessages[idx] = typeMessages[idx].get();
+	}
+	for (int idx = 0; idx < MAX_COUNTED_PORTS; ++idx) {
+		snapshot.portMessages[idx] = portMessages[idx].get();
+		snapshot.portBytes[idx] = portBytes[idx].get();
+	}
+	snapshot.otherSourceMessages = otherSourceMessages.get();
+	snapshot.otherSourceBytes = otherSourceBytes.get();
+	snapshot.otherPortMessages = otherPortMessages.get();
+	snapshot.otherPortBytes = otherPortBytes.get();
+	snapshot.dropped = dropped.get();
+	snapshot.filtered = filtered.get();
+}
+
+TrafficCounters::MessageType TrafficCounters::getMessageType(const MidiMessage& message)
+{
+	if (message.isNoteOn()) return noteOnType;
+	if (message.isNoteOff()) return noteOffType;
+	if (message.isController()) return controllerType;
+	if (message.isProgramChange()) return programChangeType;
+	if (message.isPitchWheel()) return pitchWheelType;
+	if (message.isAftertouch() || message.isChannelPressure()) return pressureType;
+	if (message.isSysEx()) return sysExType;
+	if (message.getRawDataSize() == 1 && message.getRawData()[0] >= 0xF8) return realtimeType;
+	return otherType;
+}
+
+String TrafficCounters::getMessageTypeName(int type)
+{
+	static const char* const names[numMessageTypes] = { "Note On", "Note Off", "CC", "PC", "Pitch", "Pressure", "Realtime", "SysEx", "Other" };
+	return names[type];
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#define CACHE_LINE_SIZE 64
+#define MAX_COUNTED_SOURCES 32
+#define MAX_COUNTED_PORTS 32
+#define NUM_COUNTED_CHANNELS 16
+
+// Counts the MIDI traffic without locks: every counter is atomic and sits on its own
+// cache line, so that the MIDI threads of different devices never contend for it.
+// The GUI reads a snapshot on a timer, nothing is done per event besides the increments.
+// Sources and ports beyond the counted ones share one more counter, so that no traffic is lost.
+class TrafficCounters
+{
+public:
+	enum MessageType
+	{
+		noteOnType,
+		noteOffType,
+		controllerType,
+		programChangeType,
+		pitchWheelType,
+		pressureType,
+		realtimeType,
+		sysExType,
+		otherType,
+		numMessageTypes
+	};
+
+	struct Snapshot
+	{
+		uint64 sourceMessages[MAX_COUNTED_SOURCES];
+		uint64 sourceBytes[MAX_COUNTED_SOURCES];
+		uint64 inChannelMessages[NUM_COUNTED_CHANNELS];
+		uint64 outChannelMessages[NUM_COUNTED_CHANNELS];
+		uint64 typeMessages[numMessageTypes];
+		uint64 portMessages[MAX_COUNTED_PORTS];
+		uint64 portBytes[MAX_COUNTED_PORTS];
+		uint64 otherSourceMessages;
+		uint64 otherSourceBytes;
+		uint64 otherPortMessages;
+		uint64 otherPortBytes;
+		uint64 dropped;
+		uint64 filtered;
+	};
+
+	TrafficCounters();
+	~TrafficCounters();
+
+	void countInput(const MidiMessage& message, int sourceId);
+	void countOutput(const MidiMessage& message, int port);
+	// The message could not be queued for its output
+	void countDropped();
+	// The message did not produce any output (no zone or CC mapping for it)
+	void countFiltered();
+
+	void takeSnapshot(Snapshot& snapshot) const;
+
+	static MessageType getMessageType(const MidiMessage& message);
+	static String getMessageTypeName(int type);
+
+private:
+	struct alignas(CACHE_LINE_SIZE) Counter
+	{
+		std::atomic<uint64> value { 0 };
+
+		void add(uint64 amount) { value.fetch_add(amount, std::memory_order_relaxed); }
+		uint64 get() const { return value.load(std::memory_order_relaxed); }
+	};
+
+	Counter sourceMessages[MAX_COUNTED_SOURCES];
+	Counter sourceBytes[MAX_COUNTED_SOURCES];
+	Counter inChannelMessages[NUM_COUNTED_CHANNELS];
+	Counter outChannelMessages[NUM_COUNTED_CHANNELS];
+	Counter typeMessages[numMessageTypes];
+	Counter portMessages[MAX_COUNTED_PORTS];
+	Counter portBytes[MAX_COUNTED_PORTS];
+	Counter otherSourceMessages;
+	Counter otherSourceBytes;
+	Counter otherPortMessages;
+	Counter otherPortBytes;
+	Counter dropped;
+	Counter filtered;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrafficCounters)
+};
@@ -0,0 +1,329 @@
+#include <JuceHeader.h>
+#include "ZoneRouter.h"
+#include "Arpeggiator.h"
+
+// Kind of event for every status nibble (0x8 - 0xF)
+static const uint8 eventKindOfStatus[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 2, 3, 0, 0, 0 };
+
+ZoneRouter::ZoneRouter() : eventKinds(DEFAULT_BLOCK_SIZE)
+{
+	configurations.push_back(Setlist::createDefaultConfiguration());
+}
+
+ZoneRouter::~ZoneRouter()
+{
+}
+
+void ZoneRouter::setConfigurations(std::vector<ZoneConfiguration> newConfigurations)
+{
+	if (newConfigurations.empty()) newConfigurations.push_back(Setlist::createDefaultConfiguration());
+	{
+		const SpinLock::ScopedLockType sl(lock);
+		std::swap(configurations, newConfigurations);
+		currentConfigurationIdx = 0;
+	}
+	if (arpeggiator != nullptr) arpeggiator->stopAll();
+	// The old setlist is released here, outside of the lock
+}
+
+void ZoneRouter::setCCMapping(CCMapping newMapping)
+{
+	const SpinLock::ScopedLockType sl(lock);
+	std::swap(ccMapping, newMapping);
+}
+
+void ZoneRouter::setArpeggiator(Arpeggiator* newArpeggiator)
+{
+	const SpinLock::ScopedLockType sl(lock);
+	arpeggiator = newArpeggiator;
+}
+
+void ZoneRouter::selectConfiguration(int configurationIdx, Output& output)
+{
+	const SpinLock::ScopedLockType sl(lock);
+	if (configurationIdx < 0 || configurationIdx >= (int)configurations.size()) return;
+	currentConfigurationIdx = configurationIdx;
+	// The patterns of the previous song stop with it
+	if (arpeggiator != nullptr) arpeggiator->stopAll();
+	const ZoneConfiguration& configuration = configurations[currentConfigurationIdx];
+	for (auto& bs : configuration.bankSelects) {
+		output.routeMidiMessage(MidiMessage::controllerEvent(bs.outChannel, 0, bs.bankNumber), bs.outPort);
+	}
+	for (auto& pc : configuration.programChanges) {
+		output.routeMidiMessage(MidiMessage::programChange(pc.outChannel, pc.programChangeNumber), pc.outPort);
+	}
+}
+
+int ZoneRouter::getCurrentConfigurationIdx()
+{
+	const SpinLock::ScopedLockType sl(lock);
+	return currentConfigurationIdx;
+}
+
+int ZoneRouter::getNumConfigurations()
+{
+	const SpinLock::ScopedLockType sl(lock);
+	return (int)configurations.size();
+}
+
+void ZoneRouter::processMidiMessage(const MidiMessage& message, Output& output, int sourceId)
+{
+	if (sourceId < 0 || sourceId >= MAX_INPUT_SOURCES) sourceId = ANY_INPUT_SOURCE;
+	if (message.isNoteOnOrOff()) {
+		const SpinLock::ScopedLockType sl(lock);
+		routeNote(message, sourceId, output);
+	}
+	else if (message.isProgramChange()) {
+		// Not under the lock: a song change selects a new configuration
+		handleProgramChange(message, output);
+	}
+	else if (message.isController()) {
+		const SpinLock::ScopedLockType sl(lock);
+		routeController(message, sourceId, output);
+	}
+	else {
+		// MIDI Thru
+		output.routeMidiMessage(message, DEFAULT_OUTPUT_PORT);
+	}
+}
+
+void ZoneRouter::processEventBlock(const MidiEventBlock& input, BlockOutput& output)
+{
+	const int firstOutputIdx = output.events.size();
+	for (int chunkStart = 0; chunkStart < input.size(); chunkStart += DEFAULT_BLOCK_SIZE) {
+		const int chunkEnd = jmin(input.size(), chunkStart + DEFAULT_BLOCK_SIZE);
+		const uint8* status = input.status.get() + chunkStart;
+		uint8* kinds = eventKinds.get();
+
+		// Classify
+		for (int idx = 0; idx < chunkEnd - chunkStart; ++idx) {
+			kinds[idx] = eventKindOfStatus[status[idx] >> 4];
+		}
+
+		// Remap, holding the lock until a Program Change (which may change the configuration)
+		int idx = chunkStart;
+		while (idx < chunkEnd) {
+			{
+				const SpinLock::ScopedLockType sl(lock);
+				for (; idx < chunkEnd && kinds[idx - chunkStart] != programChangeEvent; ++idx) {
+					output.samplePosition = input.samplePosition[idx];
+					if (kinds[idx - chunkStart] == noteEvent) routeBlockNote(input, idx, output);
+					else if (kinds[idx - chunkStart] == controllerEvent) routeBlockController(input, idx, output);
+					else output.addEvent(input.status[idx], input.data1[idx], input.data2[idx]); // MIDI Thru
+				}
+			}
+			if (idx < chunkEnd) {
+				output.samplePosition = input.samplePosition[idx];
+				handleProgramChange(MidiMessage(input.status[idx], input.data1[idx], (double)input.samplePosition[idx]), output);
+				++idx;
+			}
+		}
+	}
+
+	// Transpose (0 for everything but the routed notes); as in processMidiMessage, the notes
+	// transposed out of range are dropped
+	uint8* data1 = output.events.data1.get();
+	const int* transpose = output.events.transpose.get();
+	int numKept = firstOutputIdx;
+	for (int idx = firstOutputIdx; idx < output.events.size(); ++idx) {
+		if (!isInNoteRange(data1[idx] + transpose[idx])) continue;
+		if (idx != numKept) output.events.copyEvent(idx, numKept);
+		data1[numKept] = (uint8)(data1[numKept] + transpose[numKept]);
+		++numKept;
+	}
+	output.events.truncate(numKept);
+}
+
+void ZoneRouter::routeBlockNote(const MidiEventBlock& input, int eventIdx, BlockOutput& output)
+{
+	const int channel = (input.status[eventIdx] & 0x0F) + 1;
+	const int noteNumber = input.data1[eventIdx];
+	const bool isNoteOn = (input.status[eventIdx] & 0xF0) == 0x90 && input.data2[eventIdx] > 0;
+	// The block comes from a single input: the zones of any device
+	DeviceZones& device = configurations[currentConfigurationIdx].devices[ANY_DEVICE_INPUT];
+	const NoteZoneTable& table = device.noteZoneTables[channel];
+	for (int tableIdx = table.start[noteNumber]; tableIdx < table.start[noteNumber + 1]; ++tableIdx) {
+		Zone& zone = device.zones[channel][table.zoneIndices[tableIdx]];
+		uint8 velocity = input.data2[eventIdx];
+		if (!applyVelocity(zone, isNoteOn, noteNumber, velocity)) continue;
+		if (zone.hasArpeggiator && arpeggiator != nullptr && output.getEventTime() > 0.0) {
+			arpeggiator->advanceTo(output.getEventTime());
+			routeArpeggiator(zone, isNoteOn, noteNumber, velocity);
+			continue;
+		}
+		if (zone.hasHarmony && zone.harmonyIndex[noteNumber] != NO_HARMONY) {
+			MidiMessage message(input.status[eventIdx], input.data1[eventIdx], velocity, (double)output.samplePosition);
+			routeHarmony(message, zone, zone.harmonies[zone.harmonyIndex[noteNumber]], output);
+			continue;
+		}
+		output.addEvent((uint8)((input.status[eventIdx] & 0xF0) | (zone.outChannel - 1)), input.data1[eventIdx], velocity,
+			zone.outPort, zone.transpose);
+	}
+}
+
+void ZoneRouter::routeBlockController(const MidiEventBlock& input, int eventIdx, BlockOutput& output)
+{
+	for (auto& target : ccMapping.devices[ANY_DEVICE_INPUT].targets[input.data1[eventIdx]]) {
+		output.addEvent((uint8)(0xB0 | (target.outChannel - 1)), (uint8)target.outCC, input.data2[eventIdx], target.outPort);
+	}
+}
+
+void ZoneRouter::BlockOutput::routeMidiMessage(const MidiMessage& message, int port)
+{
+	const uint8* data = message.getRawData();
+	const int size = message.getRawDataSize();
+	if (size > 3) return; // Only short messages are produced by the routing of short events
+	addEvent(data[0], size > 1 ? data[1] : 0, size > 2 ? data[2] : 0, port);
+}
+
+void ZoneRouter::BlockOutput::addEvent(uint8 status, uint8 data1, uint8 data2, int port, int transpose)
+{
+	if (events.addEvent(status, data1, data2, samplePosition, port, transpose)) return;
+	const uint8 type = status & 0xF0;
+	const bool isNoteOff = type == 0x80 || (type == 0x90 && data2 == 0);
+	const bool isAllNotesOff = type == 0xB0 && data1 == 123;
+	if (overflowMidi != nullptr && (isNoteOff || isAllNotesOff)) {
+		if (!isInNoteRange(data1 + transpose)) return; // As its Note On
+		if (numOverflowEvents < maxOverflowEvents) {
+			const uint8 bytes[3] = { status, (uint8)(data1 + transpose), data2 };
+			overflowMidi->addEvent(bytes, 3, samplePosition);
+			++numOverflowEvents;
+		}
+		else overflowChannels |= 1u << (status & 0x0F);
+		return;
+	}
+	++numDropped;
+}
+
+void ZoneRouter::routeNote(const MidiMessage& message, int sourceId, Output& output)
+{
+	const int noteNumber = message.getNoteNumber();
+	const bool isNoteOn = message.isNoteOn();
+	ZoneConfiguration& configuration = configurations[currentConfigurationIdx];
+	DeviceZones& device = configuration.devices[sourceId == ANY_INPUT_SOURCE ? ANY_DEVICE_INPUT : configuration.deviceOfSource[sourceId]];
+	const NoteZoneTable& table = device.noteZoneTables[message.getChannel()];
+	for (int tableIdx = table.start[noteNumber]; tableIdx < table.start[noteNumber + 1]; ++tableIdx) {
+		Zone& zone = device.zones[message.getChannel()][table.zoneIndices[tableIdx]];
+		uint8 velocity = message.getVelocity();
+		if (!applyVelocity(zone, isNoteOn, noteNumber, velocity)) continue;
+		if (zone.hasArpeggiator && arpeggiator != nullptr) {
+			routeArpeggiator(zone, isNoteOn, noteNumber, velocity);
+			continue;
+		}
+		MidiMessage newMessage(message);
+		if (isNoteOn) newMessage.setVelocity(velocity / (float)MAX_VELOCITY);
+		if (zone.hasHarmony && zone.harmonyIndex[noteNumber] != NO_HARMONY) {
+			routeHarmony(newMessage, zone, zone.harmonies[zone.harmonyIndex[noteNumber]], output);
+			continue;
+		}
+		// Change the channel
+		newMessage.setChannel(zone.outChannel);
+		// Transpose, dropping the notes out of range
+		if (!isInNoteRange(noteNumber + zone.transpose)) continue;
+		newMessage.setNoteNumber(noteNumber + zone.transpose);
+		// Send message
+		output.routeMidiMessage(newMessage, zone.outPort);
+	}
+}
+
+bool ZoneRouter::applyVelocity(Zone& zone, bool isNoteOn, int noteNumber, uint8& velocity)
+{
+	if (isNoteOn) {
+		velocity = zone.velocityTable[velocity];
+		if (velocity == OUT_OF_VELOCITY_RANGE) return false;
+		if (zone.hasVelocityRange) zone.activeNotes[noteNumber] = true;
+	}
+	else if (zone.hasVelocityRange) {
+		// Note Off: only where the Note On was played
+		if (!zone.activeNotes[noteNumber]) return false;
+		zone.activeNotes[noteNumber] = false;
+	}
+	return true;
+}
+
+void ZoneRouter::routeHarmony(const MidiMessage& message, const Zone& zone, const std::vector<int>& outNotes, Output& output)
+{
+	// Zones with harmonies work in monophony
+	bool canDo = true;
+	if (message.isNoteOn() && !isHarmonyNoteOn) isHarmonyNoteOn = true;
+	else if (message.isNoteOff() && !isHarmonyTwoNoteOn) isHarmonyNoteOn = false;
+	else if (message.isNoteOn() && isHarmonyNoteOn) {
+		isHarmonyTwoNoteOn = true;
+		output.routeMidiMessage(MidiMessage::allNotesOff(zone.outChannel), zone.outPort);
+	}
+	else if (message.isNoteOff() && isHarmonyTwoNoteOn) {
+		canDo = false;
+		isHarmonyTwoNoteOn = false;
+	}
+	// Send messages
+	if (canDo) {
+		MidiMessage newMessage(message);
+		newMessage.setChannel(zone.outChannel);
+		for (int outNote : outNotes) {
+			if (!isInNoteRange(outNote + zone.transpose)) continue;
+			newMessage.setNoteNumber(outNote + zone.transpose);
+			output.routeMidiMessage(newMessage, zone.outPort);
+		}
+	}
+}
+
+void ZoneRouter::routeArpeggiator(const Zone& zone, bool isNoteOn, int noteNumber, uint8 velocity)
+{
+	// A harmony gives all its notes to the pattern, in the order of outNotes
+	if (zone.hasHarmony && zone.harmonyIndex[noteNumber] != NO_HARMONY) {
+		for (int outNote : zone.harmonies[zone.harmonyIndex[noteNumber]]) {
+			if (isNoteOn) arpeggiator->noteOn(zone, outNote + zone.transpose, velocity);
+			else arpeggiator->noteOff(zone, outNote + zone.transpose);
+		}
+	}
+	else if (isNoteOn) arpeggiator->noteOn(zone, noteNumber + zone.transpose, velocity);
+	else arpeggiator->noteOff(zone, noteNumber + zone.transpose);
+}
+
+void ZoneRouter::routeController(const MidiMessage& message, int sourceId, Output& output)
+{
+	const DeviceCCTargets& device = ccMapping.devices[sourceId == ANY_INPUT_SOURCE ? ANY_DEVICE_INPUT : ccMapping.deviceOfSource[sourceId]];
+	// Convert the CC, keeping the time stamp of the incoming one
+	for (auto& target : device.targets[message.getControllerNumber()]) {
+		output.routeMidiMessage(MidiMessage(MidiMessage::controllerEvent(target.outChannel, target.outCC, message.getControllerValue()), message.getTimeStamp()), target.outPort);
+	}
+}
+
+void ZoneRouter::handleProgramChange(const MidiMessage& message, Output& output)
+{
+	// Change current file
+	int programChangeNumber = message.getProgramChangeNumber();
+	if (programChangeNumber == PC_PREVIOUS_FILE) output.songChangeRequested(-1);
+	if (programChangeNumber == PC_NEXT_FILE) output.songChangeRequested(1);
+	if (programChangeNumber == PC_ORCHESTRA_SUSTAIN || programChangeNumber == PC_ORCHESTRA_STACCATO || programChangeNumber == PC_ORCHESTRA_PIZZICATO) changeOrchestraArticulation(programChangeNumber, output);
+	if (programChangeNumber == PC_TOGGLE_LESLIE) toggleLeslieState(output);
+}
+
+void ZoneRouter::changeOrchestraArticulation(int programChangeNumber, Output& output)
+{
+	int noteNumber;
+	if (programChangeNumber == PC_ORCHESTRA_SUSTAIN) {
+		noteNumber = ORCHESTRA_SUSTAIN_NOTE;
+	}
+	else if (programChangeNumber == PC_ORCHESTRA_STACCATO) {
+		noteNumber = ORCHESTRA_STACCATO_NOTE;
+	}
+	else {
+		noteNumber = ORCHESTRA_PIZZICATO_NOTE;
+	}
+	for (int channel : { ORCHESTRA_LOW_CHANNEL, ORCHESTRA_MID_CHANNEL, ORCHESTRA_HIGH_CHANNEL }) {
+		output.routeMidiMessage(MidiMessage::noteOn(channel, noteNumber, (uint8)127), DEFAULT_OUTPUT_PORT);
+		output.routeMidiMessage(MidiMessage::noteOff(channel, noteNumber), DEFAULT_OUTPUT_PORT);
+	}
+}
+
+void ZoneRouter::toggleLeslieState(Output& output)
+{
+	output.routeMidiMessage(MidiMessage::controllerEvent(B3_CHANNEL, B3_LESLIE_CC, 127 * leslieState), DEFAULT_OUTPUT_PORT);
+	leslieState = !leslieState;
+}
+
+bool ZoneRouter::isInNoteRange(int noteNumber)
+{
+	return noteNumber >= MIN_NOTE_NUMBER && noteNumber <= MAX_NOTE_NUMBER;
+}
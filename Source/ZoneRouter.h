@@ -0,0 +1,132 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Setlist.h"
+#include "MidiEventBlock.h"
+
+// Special Program Changes
+#define PC_PREVIOUS_FILE 0
+#define PC_NEXT_FILE 1
+#define PC_ORCHESTRA_SUSTAIN 4
+#define PC_ORCHESTRA_STACCATO 5
+#define PC_ORCHESTRA_PIZZICATO 6
+#define PC_TOGGLE_LESLIE 7
+
+#define ORCHESTRA_LOW_CHANNEL 1
+#define ORCHESTRA_MID_CHANNEL 2
+#define ORCHESTRA_HIGH_CHANNEL 3
+#define ORCHESTRA_STACCATO_NOTE 12
+#define ORCHESTRA_PIZZICATO_NOTE 13
+#define ORCHESTRA_SUSTAIN_NOTE 14
+#define B3_LESLIE_CC 82
+#define B3_CHANNEL 4
+
+// Events classified at once by the block routing
+#define DEFAULT_BLOCK_SIZE 1024
+
+class Arpeggiator;
+
+// Applies zones, harmonies, CC mapping and Program Changes to incoming messages.
+// It does not know where messages come from or go to, so the same logic runs in the
+// application (real MIDI ports) and in the plugin (host MidiBuffer).
+// Routing never allocates: the setlist is compiled before being handed over.
+class ZoneRouter
+{
+public:
+	// Receives the routed messages; a new one can be passed for every processed message
+	class Output
+	{
+	public:
+		virtual ~Output() {}
+		virtual void routeMidiMessage(const MidiMessage& message, int port) = 0;
+		// Program Changes 0 and 1 ask to move in the setlist by this amount of files
+		virtual void songChangeRequested(int delta) {}
+	};
+
+	// Appends the routed messages to an event block, at the position of the event being routed.
+	// When the block is full, Note Offs and All Notes Off go to overflowMidi (without their port,
+	// already transposed) so that no note is left hanging; the other events are counted and dropped.
+	// Beyond maxOverflowEvents, the channels of the Note Offs are only marked in overflowChannels
+	// (1 << (channel - 1)), for an All Notes Off each, so that overflowMidi never grows.
+	class BlockOutput : public Output
+	{
+	public:
+		BlockOutput(MidiEventBlock& e, MidiBuffer* overflow = nullptr, int maxOverflow = 0)
+			: events(e), overflowMidi(overflow), maxOverflowEvents(maxOverflow)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+		void addEvent(uint8 status, uint8 data1, uint8 data2, int port = DEFAULT_OUTPUT_PORT, int transpose = 0);
+		// Time of the event being routed on the clock of the arpeggiator, 0 without one
+		virtual double getEventTime() { return 0.0; }
+
+		MidiEventBlock& events;
+		MidiBuffer* overflowMidi;
+		const int maxOverflowEvents;
+		int numOverflowEvents = 0;
+		uint32 overflowChannels = 0;
+		int samplePosition = 0;
+		int numDropped = 0;
+	};
+
+	ZoneRouter();
+	~ZoneRouter();
+
+	// These are called from the thread that owns the setlist, not from the MIDI thread
+	void setConfigurations(std::vector<ZoneConfiguration> newConfigurations);
+	void setCCMapping(CCMapping newMapping);
+
+	// Notes of arpeggiated zones are given to the arpeggiator; without one those zones play
+	// their notes directly. The block routing uses it when the output gives the time of the
+	// events: the arpeggiator (without its own thread) is advanced to every arpeggiated note.
+	void setArpeggiator(Arpeggiator* newArpeggiator);
+
+	// Makes a configuration the current one and sends its Bank Selects and Program Changes
+	void selectConfiguration(int configurationIdx, Output& output);
+	int getCurrentConfigurationIdx();
+	int getNumConfigurations();
+
+	// sourceId is the id of the input device given to the setlist when it was resolved, so that
+	// the tables of the device are found by index; ANY_INPUT_SOURCE uses the tables of any device
+	void processMidiMessage(const MidiMessage& message, Output& output, int sourceId = ANY_INPUT_SOURCE);
+
+	// Routes a whole block of events into output.events, without allocating:
+	// status bytes are classified in one pass, notes and CCs are remapped through the
+	// compiled tables, and transposition is applied to all the routed notes at the end
+	void processEventBlock(const MidiEventBlock& input, BlockOutput& output);
+
+private:
+	enum EventKind { thruEvent, noteEvent, controllerEvent, programChangeEvent };
+
+	void routeNote(const MidiMessage& message, int sourceId, Output& output);
+	bool applyVelocity(Zone& zone, bool isNoteOn, int noteNumber, uint8& velocity);
+	void routeBlockNote(const MidiEventBlock& input, int eventIdx, BlockOutput& output);
+	void routeBlockController(const MidiEventBlock& input, int eventIdx, BlockOutput& output);
+	void routeHarmony(const MidiMessage& message, const Zone& zone, const std::vector<int>& outNotes, Output& output);
+	void routeArpeggiator(const Zone& zone, bool isNoteOn, int noteNumber, uint8 velocity);
+	void routeController(const MidiMessage& message, int sourceId, Output& output);
+	void handleProgramChange(const MidiMessage& message, Output& output);
+	void changeOrchestraArticulation(int programChangeNumber, Output& output);
+	void toggleLeslieState(Output& output);
+	static bool isInNoteRange(int noteNumber);
+
+	// Protects the compiled setlist, held by the MIDI thread only while routing one message
+	SpinLock lock;
+
+	std::vector<ZoneConfiguration> configurations;
+	int currentConfigurationIdx = 0;
+	CCMapping ccMapping;
+	Arpeggiator* arpeggiator = nullptr;
+
+	// Kind of every event of the block being routed
+	HeapBlock<uint8> eventKinds;
+
+	// B3 Leslie Management
+	bool leslieState = false;
+
+	// Harmony NoteOnOff
+	bool isHarmonyNoteOn = false;
+	bool isHarmonyTwoNoteOn = false;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZoneRouter)
+};
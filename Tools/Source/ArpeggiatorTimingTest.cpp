@@ -0,0 +1,75 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ArpeggiatorTimingTest.h"
+#include "LoopbackHarness.h"
+
+ArpeggiatorTimingTest::ArpeggiatorTimingTest()
+{
+}
+
+ArpeggiatorTimingTest::~ArpeggiatorTimingTest()
+{
+}
+
+int ArpeggiatorTimingTest::run(const ArpeggiatorSettings& settings, const std::vector<int>& chord, double tempo, double durationSeconds)
+{
+	// A step every 4 / division beats, with up to all the notes of the chord (note repeat)
+	const double stepLength = 60.0 / tempo * 4.0 / settings.division;
+	steps.clear();
+	steps.reserve((size_t)((durationSeconds / stepLength + 2.0) * jmax(1, (int)chord.size())));
+
+	Zone zone;
+	zone.outChannel = DEFAULT_OUT_CHANNEL;
+	zone.outPort = DEFAULT_OUTPUT_PORT;
+	zone.hasArpeggiator = true;
+	zone.arpeggiatorSlot = 0;
+	zone.arpeggiator = settings;
+	{
+		Arpeggiator arpeggiator(*this);
+		arpeggiator.setTempo(tempo);
+		for (int noteNumber : chord) arpeggiator.noteOn(zone, noteNumber, (uint8)ARPEGGIATOR_TEST_VELOCITY);
+		Thread::sleep(roundToInt(durationSeconds * 1000.0));
+		for (int noteNumber : chord) arpeggiator.noteOff(zone, noteNumber);
+		Thread::sleep(roundToInt(stepLength * 1000.0) + 1);
+		std::cout << "Arpeggiator: " << arpeggiator.getNumPlayedSteps() << " steps at " << arpeggiator.getTempo() << " BPM, lateness (ms) mean "
+			<< arpeggiator.getMeanLateness() << ", max " << arpeggiator.getMaxLateness() << std::endl;
+	}
+
+	// Notes of the same step share their scheduled time
+	std::vector<double> latenesses;
+	std::vector<double> jitters;
+	for (size_t idx = 0; idx < steps.size(); ++idx) {
+		latenesses.push_back((steps[idx].playedTime - steps[idx].scheduledTime) * 1000.0);
+		if (idx == 0 || steps[idx].scheduledTime == steps[idx - 1].scheduledTime) continue;
+		const double scheduledInterval = steps[idx].scheduledTime - steps[idx - 1].scheduledTime;
+		const double playedInterval = steps[idx].playedTime - steps[idx - 1].playedTime;
+		jitters.push_back(std::abs(playedInterval - scheduledInterval) * 1000.0);
+	}
+	if (jitters.empty()) {
+		std::cout << "No steps were played" << std::endl;
+		return 1;
+	}
+	std::sort(latenesses.begin(), latenesses.end());
+	std::sort(jitters.begin(), jitters.end());
+	std::cout << "Received " << steps.size() << " Note Ons" << std::endl;
+	std::cout << "Lateness (ms): 50% " << LoopbackHarness::getPercentile(latenesses, 50.0) << ", 99% " << LoopbackHarness::getPercentile(latenesses, 99.0)
+		<< ", 99.9% " << LoopbackHarness::getPercentile(latenesses, 99.9) << ", max " << latenesses.back() << std::endl;
+	std::cout << "Jitter (ms): 50% " << LoopbackHarness::getPercentile(jitters, 50.0) << ", 99% " << LoopbackHarness::getPercentile(jitters, 99.0)
+		<< ", 99.9% " << LoopbackHarness::getPercentile(jitters, 99.9) << ", max " << jitters.back() << std::endl;
+
+	int numBroken = 0;
+	if (LoopbackHarness::getPercentile(jitters, 99.9) >= MAX_ARPEGGIATOR_JITTER_MS) {
+		std::cout << "FAILED: 99.9% of the jitter is not below " << MAX_ARPEGGIATOR_JITTER_MS << " ms" << std::endl;
+		++numBroken;
+	}
+	if (jitters.back() >= MAX_ARPEGGIATOR_PEAK_JITTER_MS) {
+		std::cout << "FAILED: the largest jitter is not below " << MAX_ARPEGGIATOR_PEAK_JITTER_MS << " ms" << std::endl;
+		++numBroken;
+	}
+	return numBroken;
+}
+
+void ArpeggiatorTimingTest::routeMidiMessage(const MidiMessage& message, int /*port*/)
+{
+	if (!message.isNoteOn() || steps.size() == steps.capacity()) return;
+	steps.push_back({ message.getTimeStamp(), Arpeggiator::getCurrentTime() });
+}
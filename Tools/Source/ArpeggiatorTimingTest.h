@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/Arpeggiator.h"
+
+#define DEFAULT_ARPEGGIATOR_TEST_DURATION 10.0
+#define ARPEGGIATOR_TEST_VELOCITY 100
+// Well under 1 ms: the 99.9th percentile of the jitter must stay below this, and no step
+// may be off by a whole millisecond
+#define MAX_ARPEGGIATOR_JITTER_MS 0.5
+#define MAX_ARPEGGIATOR_PEAK_JITTER_MS 1.0
+
+// Holds a chord on an arpeggiated zone and measures, for every step that comes out:
+// - how late it is on the time it was scheduled for
+// - how far the interval from the previous step is from the scheduled one (the jitter)
+class ArpeggiatorTimingTest : private ZoneRouter::Output
+{
+public:
+	ArpeggiatorTimingTest();
+	~ArpeggiatorTimingTest();
+
+	// Returns the number of broken limits
+	int run(const ArpeggiatorSettings& settings, const std::vector<int>& chord, double tempo, double durationSeconds);
+
+private:
+	void routeMidiMessage(const MidiMessage& message, int port) override;
+
+	struct Step
+	{
+		double scheduledTime;
+		double playedTime;
+	};
+
+	// Filled by the arpeggiator thread, allocated before it starts
+	std::vector<Step> steps;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ArpeggiatorTimingTest)
+};
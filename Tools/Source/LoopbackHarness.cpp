@@ -0,0 +1,286 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoopbackHarness.h"
+#include "PreciseWait.h"
+
+LoopbackHarness::LoopbackHarness() : watcher(backend), io(backend, watcher), engine(io, watcher, setlist, counters, *this)
+{
+	// The first output is the one the IOComponent selects for the default port
+	addOutput(HARNESS_OUTPUT_NAME);
+	addInput(HARNESS_INPUT_NAME);
+	waitForDevices();
+}
+
+LoopbackHarness::~LoopbackHarness()
+{
+}
+
+bool LoopbackHarness::loadSetlist(const File& directory, const File& ccMappingFile)
+{
+	if (directory != File() && !setlist.loadDirectory(directory)) return false;
+	if (ccMappingFile != File() && !setlist.loadCCMappingFile(ccMappingFile)) return false;
+	// Every device of the setlist is connected, and its input enabled
+	for (auto& configuration : setlist.getConfigurations()) {
+		for (auto& device : configuration.devices) {
+			if (device.inDevice.isNotEmpty()) addInput(device.inDevice);
+			for (auto& zones : device.zones) {
+				for (auto& zone : zones) addOutput(zone.outDevice);
+			}
+		}
+		for (auto& pc : configuration.programChanges) addOutput(pc.outDevice);
+		for (auto& bs : configuration.bankSelects) addOutput(bs.outDevice);
+	}
+	for (auto& device : setlist.getCCMapping().devices) {
+		if (device.inDevice.isNotEmpty()) addInput(device.inDevice);
+		for (auto& targets : device.targets) {
+			for (auto& target : targets) addOutput(target.outDevice);
+		}
+	}
+	if (!waitForDevices()) return false;
+	engine.setlistLoaded();
+	engine.ccMappingLoaded();
+	// The Bank Selects and Program Changes of the first file are not part of a run
+	waitForOutputs(SETTLE_POLL_INTERVAL_MS);
+	return true;
+}
+
+StringArray LoopbackHarness::getInputNames()
+{
+	return inputNames;
+}
+
+bool LoopbackHarness::enableApplicationConsumers(const File& logFile)
+{
+	// The names of the sources are written when the recorder starts
+	if (!engine.getRecorder().start(logFile)) return false;
+	if (!engine.getOsc().start(OSC_DEFAULT_HOST, HARNESS_OSC_SEND_PORT, HARNESS_OSC_RECEIVE_PORT)) return false;
+	engine.getOsc().setMirrorRoutedMessages(true);
+	hasApplicationConsumers = true;
+	return true;
+}
+
+void LoopbackHarness::dispatchMonitorMessages(int timeoutMs)
+{
+	if (!hasApplicationConsumers) return;
+	const uint32 endTime = Time::getMillisecondCounter() + (uint32)timeoutMs;
+	while (getNumPendingMonitorMessages() > 0 && Time::getMillisecondCounter() < endTime) {
+		MessageManager::getInstance()->runDispatchLoopUntil(1);
+	}
+}
+
+int64 LoopbackHarness::getNumPendingMonitorMessages()
+{
+	return numPostedMonitorMessages.load() - numDeliveredMonitorMessages.load();
+}
+
+int64 LoopbackHarness::getNumCountedOutputs()
+{
+	TrafficCounters::Snapshot snapshot;
+	counters.takeSnapshot(snapshot);
+	int64 numCounted = (int64)(snapshot.otherPortMessages - startCounters.otherPortMessages);
+	for (int port = 0; port < MAX_COUNTED_PORTS; ++port) numCounted += (int64)(snapshot.portMessages[port] - startCounters.portMessages[port]);
+	return numCounted;
+}
+
+int64 LoopbackHarness::getNumCountedDropped()
+{
+	TrafficCounters::Snapshot snapshot;
+	counters.takeSnapshot(snapshot);
+	return (int64)(snapshot.dropped - startCounters.dropped);
+}
+
+int64 LoopbackHarness::getNumSilencingEvents()
+{
+	return numSilencingEvents;
+}
+
+int LoopbackHarness::getNumOscDropped()
+{
+	return engine.getOsc().getNumDropped();
+}
+
+void LoopbackHarness::run(const std::vector<Event>& events, int settleTimeMs)
+{
+	start();
+	injectEvents(events);
+	waitForOutputs(settleTimeMs);
+	takeCapturedEvents(capturedEvents);
+}
+
+void LoopbackHarness::start()
+{
+	backend.clearCapturedEvents();
+	numInjectedEvents = 0;
+	numRoutedEvents = 0;
+	numDroppedEvents = 0;
+	numSilencingEvents = 0;
+	counters.takeSnapshot(startCounters);
+	resetQueueHighWaterMarks();
+	startTime = LoopbackMidiBackend::getCurrentTime();
+}
+
+void LoopbackHarness::injectEvents(const std::vector<Event>& events)
+{
+	for (auto& event : events) {
+		waitUntil(event.time);
+		if (backend.injectMessage(inputNames[event.input], event.message)) ++numInjectedEvents;
+	}
+}
+
+void LoopbackHarness::waitForOutputs(int settleTimeMs)
+{
+	int numCaptured = -1;
+	double lastCaptureTime = LoopbackMidiBackend::getCurrentTime();
+	for (;;) {
+		Thread::sleep(SETTLE_POLL_INTERVAL_MS);
+		bool isPending = false;
+		for (int port = 0; port < io.getNumOutputPorts(); ++port) isPending = isPending || io.getOutputSender(port)->getNumPendingMessages() > 0;
+		const double now = LoopbackMidiBackend::getCurrentTime();
+		if (isPending || backend.getNumCapturedEvents() != numCaptured) {
+			numCaptured = backend.getNumCapturedEvents();
+			lastCaptureTime = now;
+		}
+		else if ((now - lastCaptureTime) * 1000.0 >= settleTimeMs) break;
+	}
+}
+
+void LoopbackHarness::takeCapturedEvents(std::vector<LoopbackMidiBackend::CapturedEvent>& events)
+{
+	backend.takeCapturedEvents(events);
+}
+
+const std::vector<LoopbackMidiBackend::CapturedEvent>& LoopbackHarness::getCapturedEvents()
+{
+	return capturedEvents;
+}
+
+int64 LoopbackHarness::getNumInjectedEvents()
+{
+	return numInjectedEvents;
+}
+
+int64 LoopbackHarness::getNumRoutedEvents()
+{
+	return numRoutedEvents;
+}
+
+int64 LoopbackHarness::getNumDroppedEvents()
+{
+	return numDroppedEvents;
+}
+
+int LoopbackHarness::getNumLostCaptures()
+{
+	return backend.getNumLostCaptures();
+}
+
+int LoopbackHarness::getNumOutputPorts()
+{
+	return io.getNumOutputPorts();
+}
+
+int LoopbackHarness::getQueueHighWaterMark()
+{
+	int highWaterMark = 0;
+	for (int port = 0; port < io.getNumOutputPorts(); ++port) highWaterMark = jmax(highWaterMark, io.getOutputSender(port)->getHighWaterMark());
+	return highWaterMark;
+}
+
+void LoopbackHarness::resetQueueHighWaterMarks()
+{
+	for (int port = 0; port < io.getNumOutputPorts(); ++port) io.getOutputSender(port)->resetHighWaterMark();
+}
+
+std::vector<double> LoopbackHarness::getLatencies()
+{
+	std::vector<double> latencies;
+	latencies.reserve(capturedEvents.size());
+	for (auto& event : capturedEvents) {
+		const double latency = getLatency(event);
+		if (latency >= 0.0) latencies.push_back(latency);
+	}
+	std::sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+
+double LoopbackHarness::getLatency(const LoopbackMidiBackend::CapturedEvent& event)
+{
+	// Messages generated by the router itself have no time stamp
+	if (event.message.getTimeStamp() <= 0.0) return -1.0;
+	return (event.time - event.message.getTimeStamp()) * 1000.0;
+}
+
+double LoopbackHarness::getPercentile(const std::vector<double>& sortedValues, double percentile)
+{
+	if (sortedValues.empty()) return 0.0;
+	const size_t rank = (size_t)std::ceil(percentile / 100.0 * sortedValues.size());
+	return sortedValues[jlimit((size_t)0, sortedValues.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+void LoopbackHarness::messageRouted(const MidiMessage& message, int /*port*/, bool isQueued, const String& sourceName)
+{
+	++numRoutedEvents;
+	if (!isQueued) ++numDroppedEvents;
+	// As the application, only the messages routed from an input are shown
+	if (!hasApplicationConsumers || sourceName.isEmpty()) return;
+	++numPostedMonitorMessages;
+	(new MonitorMessage(*this, message, sourceName))->post();
+}
+
+void LoopbackHarness::songChangeRequested(int delta)
+{
+	if (!(delta < 0 ? setlist.selectPreviousFile() : setlist.selectNextFile())) return;
+	// The All Notes Off of every port, queued by the IOComponent without being routed
+	const int numSilencingMessages = NUM_MIDI_CHANNELS * io.getNumOutputPorts();
+	numRoutedEvents += numSilencingMessages;
+	numSilencingEvents += numSilencingMessages;
+	engine.changeSong(setlist.getCurrentFileIdx());
+}
+
+void LoopbackHarness::MonitorMessage::messageCallback()
+{
+	owner.monitorTextLength += (source + ": " + message.getDescription()).length();
+	++owner.numDeliveredMonitorMessages;
+}
+
+void LoopbackHarness::addInput(const String& name)
+{
+	if (inputNames.contains(name)) return;
+	backend.addInputDevice(name);
+	inputNames.add(name);
+	// Opened by the watcher once it has found the device
+	engine.addInputSource(name);
+}
+
+void LoopbackHarness::addOutput(const String& name)
+{
+	if (name.isEmpty() || backend.getOutputDevices().contains(name)) return;
+	if (backend.getOutputDevices().size() >= HARNESS_MAX_OUTPUT_PORTS) return;
+	backend.addOutputDevice(name);
+}
+
+bool LoopbackHarness::waitForDevices()
+{
+	const uint32 endTime = Time::getMillisecondCounter() + HARNESS_DEVICE_TIMEOUT_MS;
+	for (;;) {
+		// The IOComponent takes the lists of the watcher on the message thread
+		MessageManager::getInstance()->runDispatchLoopUntil(SETTLE_POLL_INTERVAL_MS);
+		if (areDevicesReady()) return true;
+		if (Time::getMillisecondCounter() >= endTime) return false;
+	}
+}
+
+bool LoopbackHarness::areDevicesReady()
+{
+	if (watcher.getInputDevices() != backend.getInputDevices() || watcher.getOutputDevices() != backend.getOutputDevices()) return false;
+	if (io.getMidiOutputPortNames()[DEFAULT_OUTPUT_PORT] != HARNESS_OUTPUT_NAME) return false;
+	for (auto& name : inputNames) {
+		if (!watcher.isInputOpen(name)) return false;
+	}
+	return true;
+}
+
+void LoopbackHarness::waitUntil(double eventTime)
+{
+	// The loopback backend uses the same clock
+	waitUntilPreciseTime(startTime + eventTime);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/Setlist.h"
+#include "../../Source/LoopbackMidiBackend.h"
+#include "../../Source/MidiDeviceWatcher.h"
+#include "../../Source/IOComponent.h"
+#include "../../Source/RoutingEngine.h"
+#include "../../Source/TrafficCounters.h"
+
+#define HARNESS_INPUT_NAME "Zonifier Loopback In"
+#define HARNESS_OUTPUT_NAME "Zonifier Loopback Out"
+#define HARNESS_MAX_OUTPUT_PORTS MAX_OUTPUT_PORTS
+#define DEFAULT_SETTLE_TIME_MS 200
+#define SETTLE_POLL_INTERVAL_MS 5
+// Time given to the device watcher to find the loopback devices and open the inputs
+#define HARNESS_DEVICE_TIMEOUT_MS 5000
+// Not the ports of the application, which may be running on the same machine
+#define HARNESS_OSC_SEND_PORT 9101
+#define HARNESS_OSC_RECEIVE_PORT 9100
+
+// Runs the routing engine of the application on loopback devices, with its device watcher and
+// IOComponent: every device named by the setlist is a loopback device, every input is enabled
+// as in the application and routes with the zones of its device, the routed messages are queued
+// to one sender thread per output port, and the outputs capture what they receive with its time.
+// This thread is the message thread. The traffic counters always count; with the consumers of
+// the application enabled, every message also goes to the session recorder, the OSC mirror and
+// the monitor of the message thread. A song change is done at once on the thread that asked for
+// it, where the application goes through its file list on the message thread.
+class LoopbackHarness    : private RoutingEngine::Listener
+{
+public:
+	struct Event
+	{
+		// Seconds from the start of the run
+		double time;
+		MidiMessage message;
+		// Index of the device in getInputNames() (0 when omitted, the input of the harness)
+		int input;
+	};
+
+	LoopbackHarness();
+	~LoopbackHarness();
+
+	// Connects the devices named by the files, then hands the setlist to the engine
+	bool loadSetlist(const File& directory, const File& ccMappingFile);
+	// The input of the harness first, then the "inDevice" of the files
+	StringArray getInputNames();
+
+	// Call from the thread that will dispatch the monitor messages, before start()
+	bool enableApplicationConsumers(const File& logFile);
+	// Delivers the monitor messages posted so far, as the message thread of the application does
+	void dispatchMonitorMessages(int timeoutMs);
+	// Posted to the message thread and not delivered yet
+	int64 getNumPendingMonitorMessages();
+	// Counted by the traffic counters since start()
+	int64 getNumCountedOutputs();
+	int64 getNumCountedDropped();
+	// Messages queued by the router itself on a song change (All Notes Off), which the
+	// application does not count
+	int64 getNumSilencingEvents();
+	int getNumOscDropped();
+
+	// Injects the events at their time, then waits until all the queues are empty and
+	// nothing has been captured for settleTimeMs
+	void run(const std::vector<Event>& events, int settleTimeMs = DEFAULT_SETTLE_TIME_MS);
+
+	// The steps of run(), for runs too long to keep all the events in memory:
+	// start() resets the counters and the clock of the event times
+	void start();
+	void injectEvents(const std::vector<Event>& events);
+	void waitForOutputs(int settleTimeMs = DEFAULT_SETTLE_TIME_MS);
+	void takeCapturedEvents(std::vector<LoopbackMidiBackend::CapturedEvent>& events);
+
+	const std::vector<LoopbackMidiBackend::CapturedEvent>& getCapturedEvents();
+	int64 getNumInjectedEvents();
+	// Messages given by the router to the output queues, including the dropped ones
+	int64 getNumRoutedEvents();
+	// Messages that did not fit in an output queue
+	int64 getNumDroppedEvents();
+	int getNumLostCaptures();
+	int getNumOutputPorts();
+	// Largest number of messages waiting in an output queue since the last reset
+	int getQueueHighWaterMark();
+	void resetQueueHighWaterMarks();
+
+	// Input to output latencies (ms) of the captured events routed from an injected one,
+	// and of the arpeggiator steps from the time they were scheduled for
+	std::vector<double> getLatencies();
+	// -1 for the messages generated by the router itself (Program Changes, All Notes Off)
+	static double getLatency(const LoopbackMidiBackend::CapturedEvent& event);
+	// Nearest rank percentile (0 - 100) of sorted values
+	static double getPercentile(const std::vector<double>& sortedValues, double percentile);
+
+private:
+	// The monitor line of a routed message, built on the message thread as in the application
+	class MonitorMessage : public CallbackMessage
+	{
+	public:
+		MonitorMessage(LoopbackHarness& o, const MidiMessage& m, const String& s)
+			: owner(o), message(m), source(s)
+		{}
+
+		void messageCallback() override;
+
+		LoopbackHarness& owner;
+		MidiMessage message;
+		String source;
+	};
+
+	void messageRouted(const MidiMessage& message, int port, bool isQueued, const String& sourceName) override;
+	void songChangeRequested(int delta) override;
+
+	void addInput(const String& name);
+	void addOutput(const String& name);
+	bool waitForDevices();
+	bool areDevicesReady();
+	void waitUntil(double eventTime);
+
+	// First, so that this thread is the message thread of the IOComponent
+	ScopedJuceInitialiser_GUI juceInitialiser;
+	LoopbackMidiBackend backend;
+	MidiDeviceWatcher watcher;
+	IOComponent io;
+	StringArray inputNames;
+
+	Setlist setlist;
+	TrafficCounters counters;
+	TrafficCounters::Snapshot startCounters;
+
+	double startTime = 0.0;
+	int64 numInjectedEvents = 0;
+	std::atomic<int64> numRoutedEvents { 0 };
+	std::atomic<int64> numDroppedEvents { 0 };
+	std::atomic<int64> numSilencingEvents { 0 };
+	std::vector<LoopbackMidiBackend::CapturedEvent> capturedEvents;
+
+	// Consumers of the application, set before the first injected event
+	bool hasApplicationConsumers = false;
+	std::atomic<int64> numPostedMonitorMessages { 0 };
+	std::atomic<int64> numDeliveredMonitorMessages { 0 };
+	// Length of the monitor lines, so that building them is not optimised away
+	int64 monitorTextLength = 0;
+
+	// Last, its inputs and its arpeggiator thread use everything above
+	RoutingEngine engine;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopbackHarness)
+};
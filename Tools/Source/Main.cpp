@@ -0,0 +1,246 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SessionReplayer.h"
+#include "LoopbackHarness.h"
+#include "SoakTest.h"
+#include "ArpeggiatorTimingTest.h"
+#include "OscPeer.h"
+#include "PluginHostCheck.h"
+#include "../../Source/SetlistParser.h"
+
+#define DEFAULT_LATENCY_EVENTS 10000
+#define DEFAULT_LATENCY_RATE 1000.0
+#define DEFAULT_SOAK_DURATION 60.0
+#define DEFAULT_SOAK_STORMS "chords,ccsweep,programchanges,sysex"
+#define DEFAULT_ARPEGGIATOR_TEST_CHORD "48,55,60,64,67"
+#define DEFAULT_PLUGIN_CHECK_STORMS "chords,ccsweep,programchanges"
+
+static void printUsage()
+{
+	std::cout << "Usage:" << std::endl
+		<< "  midi_zonifier_tools replay <session.mzlog> [--setlist <directory>] [--ccmapping <file>]" << std::endl
+		<< "                             [--instant | --realtime | --speed <factor>] [--output <device> [--virtual-ports]] [--verbose]" << std::endl
+		<< "  midi_zonifier_tools latency [--setlist <directory>] [--ccmapping <file>] [--events <count>] [--rate <events/s>]" << std::endl
+		<< "  midi_zonifier_tools soak [--setlist <directory>] [--ccmapping <file>] [--storm <chords,ccsweep,programchanges,sysex>]" << std::endl
+		<< "                           [--duration <seconds>] [--report <seconds>] [--seed <number>]" << std::endl
+		<< "  midi_zonifier_tools arpeggiator [--mode <up|down|upDown|random|asPlayed|repeat>] [--octaves <count>] [--division <steps/whole note>]" << std::endl
+		<< "                                  [--gate <fraction>] [--swing <fraction>] [--tempo <BPM>] [--chord <notes>] [--duration <seconds>]" << std::endl
+		<< "  midi_zonifier_tools plugin [--setlist <directory>] [--ccmapping <file>] [--storm <chords,ccsweep,programchanges>]" << std::endl
+		<< "                             [--block-size <samples>] [--duration <seconds>] [--seed <number>]" << std::endl
+		<< "  midi_zonifier_tools osc [--send <next|previous|jump:<index>>] [--host <address>] [--port <events port>]" << std::endl
+		<< "                          [--command-port <port>] [--duration <seconds>]" << std::endl;
+}
+
+static String getOptionValue(const StringArray& args, const String& option)
+{
+	int idx = args.indexOf(option);
+	return idx >= 0 && idx + 1 < args.size() ? args[idx + 1] : String();
+}
+
+static File getFileOption(const StringArray& args, const String& option)
+{
+	String path = getOptionValue(args, option);
+	return path.isEmpty() ? File() : File::getCurrentWorkingDirectory().getChildFile(path);
+}
+
+static int runReplay(const StringArray& args)
+{
+	if (args.size() < 2) {
+		printUsage();
+		return 1;
+	}
+	SessionReplayer replayer;
+	if (!replayer.loadSetlist(getFileOption(args, "--setlist"), getFileOption(args, "--ccmapping"))) {
+		std::cout << "Cannot load the setlist" << std::endl;
+		return 1;
+	}
+	if (args.contains("--realtime")) replayer.setTiming(SessionReplayer::realtime);
+	else if (args.contains("--speed")) replayer.setTiming(SessionReplayer::accelerated, getOptionValue(args, "--speed").getDoubleValue());
+	replayer.setVerbose(args.contains("--verbose"));
+	String outputName = getOptionValue(args, "--output");
+	if (outputName.isNotEmpty() && !replayer.setMidiOutput(outputName, args.contains("--virtual-ports"))) {
+		std::cout << "Cannot open MIDI output " << outputName << std::endl;
+		return 1;
+	}
+
+	int numMismatches = replayer.replay(File::getCurrentWorkingDirectory().getChildFile(args[1]));
+	if (numMismatches < 0) {
+		std::cout << "Cannot read " << args[1] << std::endl;
+		return 1;
+	}
+	return numMismatches == 0 ? 0 : 2;
+}
+
+static int runLatency(const StringArray& args)
+{
+	LoopbackHarness harness;
+	if (!harness.loadSetlist(getFileOption(args, "--setlist"), getFileOption(args, "--ccmapping"))) {
+		std::cout << "Cannot load the setlist" << std::endl;
+		return 1;
+	}
+	String eventsOption = getOptionValue(args, "--events");
+	String rateOption = getOptionValue(args, "--rate");
+	const int numEvents = eventsOption.isEmpty() ? DEFAULT_LATENCY_EVENTS : jmax(1, eventsOption.getIntValue());
+	const double rate = rateOption.isEmpty() ? DEFAULT_LATENCY_RATE : jmax(1.0, rateOption.getDoubleValue());
+
+	// Notes on channel 1, going up and down the keyboard, every Note On followed by its Note Off
+	// on the same input, the inputs taking turns
+	const int numInputs = harness.getInputNames().size();
+	std::vector<LoopbackHarness::Event> events;
+	events.reserve((size_t)numEvents);
+	for (int idx = 0; idx < numEvents; ++idx) {
+		const int noteNumber = 36 + (idx / 2) % 48;
+		MidiMessage message = idx % 2 == 0 ? MidiMessage::noteOn(1, noteNumber, (uint8)100) : MidiMessage::noteOff(1, noteNumber);
+		events.push_back({ idx / rate, message, (idx / 2) % numInputs });
+	}
+	harness.run(events);
+
+	std::vector<double> latencies = harness.getLatencies();
+	std::cout << "Injected " << harness.getNumInjectedEvents() << " events: " << harness.getCapturedEvents().size() << " output events, "
+		<< harness.getNumDroppedEvents() << " dropped" << std::endl;
+	if (!latencies.empty()) {
+		std::cout << "Latency (ms): min " << latencies.front()
+			<< ", 50% " << LoopbackHarness::getPercentile(latencies, 50.0)
+			<< ", 99% " << LoopbackHarness::getPercentile(latencies, 99.0)
+			<< ", 99.9% " << LoopbackHarness::getPercentile(latencies, 99.9)
+			<< ", max " << latencies.back() << std::endl;
+	}
+	return harness.getNumDroppedEvents() == 0 ? 0 : 2;
+}
+
+static int runSoak(const StringArray& args)
+{
+	LoopbackHarness harness;
+	if (!harness.loadSetlist(getFileOption(args, "--setlist"), getFileOption(args, "--ccmapping"))) {
+		std::cout << "Cannot load the setlist" << std::endl;
+		return 1;
+	}
+	// The log is kept, so that a failed run can be replayed
+	File logFile = File::getSpecialLocation(File::tempDirectory).getChildFile("zonifier_soak.mzlog");
+	if (!harness.enableApplicationConsumers(logFile)) {
+		std::cout << "Cannot start the session recorder or the OSC endpoint" << std::endl;
+		return 1;
+	}
+	std::cout << "Session log: " << logFile.getFullPathName() << std::endl;
+	SoakTest soakTest(harness);
+	String stormsOption = getOptionValue(args, "--storm");
+	String seedOption = getOptionValue(args, "--seed");
+	const int64 seed = seedOption.isEmpty() ? Time::currentTimeMillis() : seedOption.getLargeIntValue();
+	for (auto& name : StringArray::fromTokens(stormsOption.isEmpty() ? DEFAULT_SOAK_STORMS : stormsOption, ",", String())) {
+		MidiStormGenerator::Storm storm;
+		if (!MidiStormGenerator::parseStorm(name.trim(), storm)) {
+			std::cout << "Unknown storm " << name << std::endl;
+			return 1;
+		}
+		soakTest.addStorm(storm, seed);
+	}
+	String durationOption = getOptionValue(args, "--duration");
+	String reportOption = getOptionValue(args, "--report");
+	const double duration = durationOption.isEmpty() ? DEFAULT_SOAK_DURATION : jmax(SOAK_WINDOW_SECONDS, durationOption.getDoubleValue());
+	const double reportInterval = reportOption.isEmpty() ? DEFAULT_SOAK_REPORT_INTERVAL : jmax(SOAK_WINDOW_SECONDS, reportOption.getDoubleValue());
+
+	std::cout << "Soak test of " << duration << " s, seed " << seed << std::endl;
+	return soakTest.run(duration, reportInterval) == 0 ? 0 : 2;
+}
+
+static int runArpeggiator(const StringArray& args)
+{
+	ArpeggiatorSettings settings;
+	String modeOption = getOptionValue(args, "--mode");
+	if (modeOption.isNotEmpty() && !SetlistParser::parseArpeggiatorMode(modeOption, settings.mode)) {
+		std::cout << "Unknown mode " << modeOption << std::endl;
+		return 1;
+	}
+	String octavesOption = getOptionValue(args, "--octaves");
+	String divisionOption = getOptionValue(args, "--division");
+	String gateOption = getOptionValue(args, "--gate");
+	String swingOption = getOptionValue(args, "--swing");
+	if (octavesOption.isNotEmpty()) settings.octaves = jlimit(1, MAX_ARPEGGIATOR_OCTAVES, octavesOption.getIntValue());
+	if (divisionOption.isNotEmpty()) settings.division = jlimit(1, MAX_ARPEGGIATOR_DIVISION, divisionOption.getIntValue());
+	if (gateOption.isNotEmpty()) settings.gate = jlimit(0.01, 1.0, gateOption.getDoubleValue());
+	if (swingOption.isNotEmpty()) settings.swing = jlimit(0.0, 0.5, swingOption.getDoubleValue());
+
+	String tempoOption = getOptionValue(args, "--tempo");
+	String chordOption = getOptionValue(args, "--chord");
+	String durationOption = getOptionValue(args, "--duration");
+	const double tempo = tempoOption.isEmpty() ? DEFAULT_ARPEGGIATOR_TEMPO : jlimit(MIN_ARPEGGIATOR_TEMPO, MAX_ARPEGGIATOR_TEMPO, tempoOption.getDoubleValue());
+	const double duration = durationOption.isEmpty() ? DEFAULT_ARPEGGIATOR_TEST_DURATION : jmax(1.0, durationOption.getDoubleValue());
+	std::vector<int> chord;
+	for (auto& note : StringArray::fromTokens(chordOption.isEmpty() ? DEFAULT_ARPEGGIATOR_TEST_CHORD : chordOption, ",", String())) {
+		chord.push_back(jlimit(MIN_NOTE_NUMBER, MAX_NOTE_NUMBER, note.trim().getIntValue()));
+	}
+
+	ArpeggiatorTimingTest timingTest;
+	return timingTest.run(settings, chord, tempo, duration) == 0 ? 0 : 2;
+}
+
+static int runPluginHostCheck(const StringArray& args)
+{
+	PluginHostCheck hostCheck;
+	if (!hostCheck.loadSetlist(getFileOption(args, "--setlist"), getFileOption(args, "--ccmapping"))) {
+		std::cout << "Cannot load the setlist" << std::endl;
+		return 1;
+	}
+	String stormsOption = getOptionValue(args, "--storm");
+	String seedOption = getOptionValue(args, "--seed");
+	const int64 seed = seedOption.isEmpty() ? Time::currentTimeMillis() : seedOption.getLargeIntValue();
+	for (auto& name : StringArray::fromTokens(stormsOption.isEmpty() ? DEFAULT_PLUGIN_CHECK_STORMS : stormsOption, ",", String())) {
+		MidiStormGenerator::Storm storm;
+		if (!MidiStormGenerator::parseStorm(name.trim(), storm)) {
+			std::cout << "Unknown storm " << name << std::endl;
+			return 1;
+		}
+		hostCheck.addStorm(storm, seed);
+	}
+	String blockSizeOption = getOptionValue(args, "--block-size");
+	String durationOption = getOptionValue(args, "--duration");
+	const int blockSize = blockSizeOption.isEmpty() ? DEFAULT_PLUGIN_CHECK_BLOCK_SIZE : jmax(1, blockSizeOption.getIntValue());
+	const double duration = durationOption.isEmpty() ? DEFAULT_PLUGIN_CHECK_DURATION : jmax(0.1, durationOption.getDoubleValue());
+
+	std::cout << "Plugin blocks of " << blockSize << " samples for " << duration << " s, seed " << seed << std::endl;
+	return hostCheck.run(duration, blockSize) == 0 ? 0 : 2;
+}
+
+static int runOscPeer(const StringArray& args)
+{
+	String hostOption = getOptionValue(args, "--host");
+	String portOption = getOptionValue(args, "--port");
+	String commandPortOption = getOptionValue(args, "--command-port");
+	String durationOption = getOptionValue(args, "--duration");
+	const String host = hostOption.isEmpty() ? String(OSC_DEFAULT_HOST) : hostOption;
+	const int eventsPort = portOption.isEmpty() ? OSC_DEFAULT_SEND_PORT : portOption.getIntValue();
+	const int commandPort = commandPortOption.isEmpty() ? OSC_DEFAULT_RECEIVE_PORT : commandPortOption.getIntValue();
+	const double duration = durationOption.isEmpty() ? DEFAULT_OSC_PEER_DURATION : jmax(0.1, durationOption.getDoubleValue());
+
+	OscPeer peer;
+	// Listening first, so that the song switch caused by the command is received
+	if (!peer.startListening(eventsPort)) {
+		std::cout << "Cannot listen on UDP port " << eventsPort << std::endl;
+		return 1;
+	}
+	String command = getOptionValue(args, "--send");
+	if (command.isNotEmpty() && !peer.sendCommand(host, commandPort, command)) {
+		std::cout << "Cannot send " << command << " to " << host << ":" << commandPort << std::endl;
+		return 1;
+	}
+	Thread::sleep(roundToInt(duration * 1000.0));
+	peer.stopListening();
+	std::cout << "Received " << peer.getNumBundles() << " bundles, " << peer.getNumMessages() << " messages" << std::endl;
+	return 0;
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+	StringArray args;
+	for (int idx = 1; idx < argc; ++idx) args.add(argv[idx]);
+
+	if (args.size() > 0 && args[0] == "replay") return runReplay(args);
+	if (args.size() > 0 && args[0] == "latency") return runLatency(args);
+	if (args.size() > 0 && args[0] == "soak") return runSoak(args);
+	if (args.size() > 0 && args[0] == "arpeggiator") return runArpeggiator(args);
+	if (args.size() > 0 && args[0] == "plugin") return runPluginHostCheck(args);
+	if (args.size() > 0 && args[0] == "osc") return runOscPeer(args);
+
+	printUsage();
+	return 1;
+}
@@ -0,0 +1,104 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MidiStormGenerator.h"
+
+static const int sweptControllers[] = { 1, 7, 11, 74 };
+
+MidiStormGenerator::MidiStormGenerator(Storm s, int64 seed, int inputs) : storm(s), numInputs(jmax(1, inputs)), random(seed)
+{
+}
+
+MidiStormGenerator::~MidiStormGenerator()
+{
+}
+
+void MidiStormGenerator::generate(double endTime, std::vector<LoopbackHarness::Event>& events)
+{
+	// Events are at multiples of the interval, counted so that windows never skip or repeat one
+	const double interval = getInterval();
+	for (double time = numGenerated * interval; time < endTime; time = numGenerated * interval) {
+		if (storm == chords) addChord(time, events);
+		else if (storm == ccSweep) addController(time, events);
+		else if (storm == programChanges) addProgramChange(time, events);
+		else addSysEx(time, events);
+		++numGenerated;
+	}
+}
+
+void MidiStormGenerator::finish(double time, std::vector<LoopbackHarness::Event>& events)
+{
+	if (!isChordHeld) return;
+	for (int channel = 1; channel <= NUM_MIDI_CHANNELS; ++channel) {
+		for (int noteNumber : heldNotes[channel - 1]) events.push_back({ time, MidiMessage::noteOff(channel, noteNumber), getInput(channel) });
+	}
+	isChordHeld = false;
+}
+
+bool MidiStormGenerator::parseStorm(const String& name, Storm& result)
+{
+	for (Storm candidate : { chords, ccSweep, programChanges, sysEx }) {
+		if (name.equalsIgnoreCase(getStormName(candidate))) {
+			result = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+String MidiStormGenerator::getStormName(Storm s)
+{
+	if (s == chords) return "chords";
+	if (s == ccSweep) return "ccsweep";
+	if (s == programChanges) return "programchanges";
+	return "sysex";
+}
+
+void MidiStormGenerator::addChord(double time, std::vector<LoopbackHarness::Event>& events)
+{
+	finish(time, events);
+	for (int channel = 1; channel <= NUM_MIDI_CHANNELS; ++channel) {
+		// Notes can repeat: the same key pressed twice must be released twice
+		for (int& noteNumber : heldNotes[channel - 1]) {
+			noteNumber = 24 + random.nextInt(72);
+			events.push_back({ time, MidiMessage::noteOn(channel, noteNumber, (uint8)(1 + random.nextInt(MAX_VELOCITY))), getInput(channel) });
+		}
+	}
+	isChordHeld = true;
+}
+
+void MidiStormGenerator::addController(double time, std::vector<LoopbackHarness::Event>& events)
+{
+	// Triangle from 0 to 127 and back, one step per event
+	const int step = (int)(numGenerated % 254);
+	const int value = step < 128 ? step : 254 - step;
+	const int channel = 1 + (int)(numGenerated % NUM_MIDI_CHANNELS);
+	const int controller = sweptControllers[(numGenerated / NUM_MIDI_CHANNELS) % numElementsInArray(sweptControllers)];
+	events.push_back({ time, MidiMessage::controllerEvent(channel, controller, value), getInput(channel) });
+}
+
+void MidiStormGenerator::addProgramChange(double time, std::vector<LoopbackHarness::Event>& events)
+{
+	events.push_back({ time, MidiMessage::programChange(1, random.nextInt(STORM_MAX_PROGRAM_CHANGE + 1)), getInput(1) });
+}
+
+void MidiStormGenerator::addSysEx(double time, std::vector<LoopbackHarness::Event>& events)
+{
+	// Non-commercial manufacturer id, then a counter and random 7 bit data
+	uint8 data[STORM_SYSEX_SIZE - 2];
+	data[0] = 0x7D;
+	data[1] = (uint8)(numGenerated & 0x7F);
+	for (int idx = 2; idx < STORM_SYSEX_SIZE - 2; ++idx) data[idx] = (uint8)random.nextInt(128);
+	events.push_back({ time, MidiMessage::createSysExMessage(data, STORM_SYSEX_SIZE - 2), (int)(numGenerated % numInputs) });
+}
+
+int MidiStormGenerator::getInput(int channel)
+{
+	return (channel - 1) % numInputs;
+}
+
+double MidiStormGenerator::getInterval()
+{
+	if (storm == chords) return STORM_CHORD_INTERVAL;
+	if (storm == ccSweep) return STORM_CC_INTERVAL;
+	if (storm == programChanges) return STORM_PROGRAM_CHANGE_INTERVAL;
+	return STORM_SYSEX_INTERVAL;
+}
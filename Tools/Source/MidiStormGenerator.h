@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoopbackHarness.h"
+
+#define STORM_CHORD_INTERVAL 0.05
+#define STORM_CHORD_SIZE 6
+#define STORM_CC_INTERVAL 0.001
+#define STORM_PROGRAM_CHANGE_INTERVAL 0.01
+#define STORM_MAX_PROGRAM_CHANGE 7
+#define STORM_SYSEX_INTERVAL 0.1
+#define STORM_SYSEX_SIZE 256
+
+// Generates heavy input traffic, a time window after the other, so that a storm
+// can go on for hours without keeping its events in memory. With several inputs, every
+// channel is played on its own input, so that the zones of every device are exercised.
+class MidiStormGenerator
+{
+public:
+	enum Storm
+	{
+		// Dense chords on all the 16 channels, every chord releasing the previous one
+		chords,
+		// CC sweeps at 1 kHz, rotating over channels and controllers
+		ccSweep,
+		// Random Program Changes, including the ones that change file
+		programChanges,
+		// SysEx dumps
+		sysEx
+	};
+
+	MidiStormGenerator(Storm storm, int64 seed, int numInputs = 1);
+	~MidiStormGenerator();
+
+	// Appends the events up to endTime (excluded), following the ones generated before
+	void generate(double endTime, std::vector<LoopbackHarness::Event>& events);
+	// Appends the Note Offs of the notes still held
+	void finish(double time, std::vector<LoopbackHarness::Event>& events);
+
+	static bool parseStorm(const String& name, Storm& storm);
+	static String getStormName(Storm storm);
+
+private:
+	void addChord(double time, std::vector<LoopbackHarness::Event>& events);
+	void addController(double time, std::vector<LoopbackHarness::Event>& events);
+	void addProgramChange(double time, std::vector<LoopbackHarness::Event>& events);
+	void addSysEx(double time, std::vector<LoopbackHarness::Event>& events);
+	double getInterval();
+	int getInput(int channel);
+
+	const Storm storm;
+	const int numInputs;
+	Random random;
+	int64 numGenerated = 0;
+
+	// Chords: the notes held on every channel
+	std::array<std::array<int, STORM_CHORD_SIZE>, NUM_MIDI_CHANNELS> heldNotes;
+	bool isChordHeld = false;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiStormGenerator)
+};
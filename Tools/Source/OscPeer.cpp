@@ -0,0 +1,72 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "OscPeer.h"
+
+OscPeer::OscPeer()
+{
+}
+
+OscPeer::~OscPeer()
+{
+	stopListening();
+}
+
+bool OscPeer::sendCommand(const String& host, int commandPort, const String& command)
+{
+	OSCSender sender;
+	if (!sender.connect(host, commandPort)) return false;
+	if (command == "next") return sender.send(OSCMessage(OSCAddressPattern(OSC_NEXT_ADDRESS)));
+	if (command == "previous") return sender.send(OSCMessage(OSCAddressPattern(OSC_PREVIOUS_ADDRESS)));
+	if (command.startsWith("jump:")) return sender.send(OSCMessage(OSCAddressPattern(OSC_JUMP_ADDRESS), command.fromFirstOccurrenceOf(":", false, false).getIntValue()));
+	return false;
+}
+
+bool OscPeer::startListening(int eventsPort)
+{
+	if (!receiver.connect(eventsPort)) return false;
+	receiver.addListener(this);
+	return true;
+}
+
+void OscPeer::stopListening()
+{
+	receiver.removeListener(this);
+	receiver.disconnect();
+}
+
+int OscPeer::getNumBundles()
+{
+	return numBundles.load();
+}
+
+int OscPeer::getNumMessages()
+{
+	return numMessages.load();
+}
+
+void OscPeer::oscMessageReceived(const OSCMessage& message)
+{
+	const ScopedLock sl(printLock);
+	printMessage(message, String());
+}
+
+void OscPeer::oscBundleReceived(const OSCBundle& bundle)
+{
+	const ScopedLock sl(printLock);
+	++numBundles;
+	std::cout << Time::getCurrentTime().formatted("%H:%M:%S") << " bundle of " << bundle.size() << std::endl;
+	for (auto& element : bundle) {
+		if (element.isMessage()) printMessage(element.getMessage(), "  ");
+	}
+}
+
+void OscPeer::printMessage(const OSCMessage& message, const String& indent)
+{
+	++numMessages;
+	String line = indent + message.getAddressPattern().toString();
+	for (auto& argument : message) {
+		if (argument.isInt32()) line += " " + String(argument.getInt32());
+		else if (argument.isFloat32()) line += " " + String(argument.getFloat32());
+		else if (argument.isString()) line += " \"" + argument.getString() + "\"";
+	}
+	std::cout << line << std::endl;
+}
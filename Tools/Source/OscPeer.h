@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/OscEndpoint.h"
+
+#define DEFAULT_OSC_PEER_DURATION 10.0
+
+// A local peer of the OSC endpoint of the application: it can send the song commands
+// and prints the bundles that the application publishes.
+class OscPeer : private OSCReceiver::Listener<OSCReceiver::RealtimeCallback>
+{
+public:
+	OscPeer();
+	~OscPeer();
+
+	// command is "next", "previous" or "jump:<index>"
+	bool sendCommand(const String& host, int commandPort, const String& command);
+	// Prints what is received on eventsPort until stopListening()
+	bool startListening(int eventsPort);
+	void stopListening();
+
+	int getNumBundles();
+	int getNumMessages();
+
+private:
+	void oscMessageReceived(const OSCMessage& message) override;
+	void oscBundleReceived(const OSCBundle& bundle) override;
+	void printMessage(const OSCMessage& message, const String& indent);
+
+	OSCReceiver receiver;
+	// Bundles are printed from the receiver thread
+	CriticalSection printLock;
+	std::atomic<int> numBundles { 0 };
+	std::atomic<int> numMessages { 0 };
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscPeer)
+};
@@ -0,0 +1,160 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginHostCheck.h"
+
+PluginHostCheck::PluginHostCheck() : referenceArpeggiatorOutput(*this), referenceArpeggiator(referenceArpeggiatorOutput, false)
+{
+	// The processor posts its changes to the message thread
+	MessageManager::getInstance();
+	referenceRouter.setArpeggiator(&referenceArpeggiator);
+}
+
+PluginHostCheck::~PluginHostCheck()
+{
+	referenceRouter.setArpeggiator(nullptr);
+}
+
+bool PluginHostCheck::loadSetlist(const File& directory, const File& ccMappingFile)
+{
+	if (directory != File() && !setlist.loadDirectory(directory)) return false;
+	if (ccMappingFile != File() && !setlist.loadCCMappingFile(ccMappingFile)) return false;
+	// The plugin has a single MIDI output, every "outDevice" goes to it
+	referenceRouter.setConfigurations(setlist.getConfigurations());
+	referenceRouter.setCCMapping(setlist.getCCMapping());
+
+	// As a host reopening a session
+	XmlElement state("ZONIFIER");
+	state.setAttribute("directory", directory != File() ? directory.getFullPathName() : String());
+	state.setAttribute("ccMappingFile", ccMappingFile != File() ? ccMappingFile.getFullPathName() : String());
+	state.setAttribute("currentFile", setlist.getCurrentFileIdx());
+	restoredState.reset();
+	AudioProcessor::copyXmlToBinary(state, restoredState);
+	processor.setStateInformation(restoredState.getData(), (int)restoredState.getSize());
+	return true;
+}
+
+bool PluginHostCheck::checkSavedState()
+{
+	MemoryBlock savedState;
+	processor.getStateInformation(savedState);
+	std::unique_ptr<XmlElement> saved(AudioProcessor::getXmlFromBinary(savedState.getData(), (int)savedState.getSize()));
+	std::unique_ptr<XmlElement> restored(AudioProcessor::getXmlFromBinary(restoredState.getData(), (int)restoredState.getSize()));
+	if (saved != nullptr && restored != nullptr && saved->isEquivalentTo(restored.get(), false)) return true;
+	std::cout << "The plugin saved a different state from the one it was given" << std::endl;
+	return false;
+}
+
+void PluginHostCheck::addStorm(MidiStormGenerator::Storm storm, int64 seed)
+{
+	generators.add(new MidiStormGenerator(storm, seed + generators.size()));
+}
+
+int PluginHostCheck::run(double durationSeconds, int newBlockSize)
+{
+	blockSize = newBlockSize;
+	std::vector<LoopbackHarness::Event> events;
+	for (auto generator : generators) generator->generate(durationSeconds, events);
+	for (auto generator : generators) generator->finish(durationSeconds, events);
+	std::stable_sort(events.begin(), events.end(), [](const LoopbackHarness::Event& a, const LoopbackHarness::Event& b) { return a.time < b.time; });
+
+	// The plugin selects the file of its state at its first block
+	int numMismatches = checkSavedState() ? 0 : 1;
+	processor.prepareToPlay(PLUGIN_CHECK_SAMPLE_RATE, blockSize);
+	referenceArpeggiator.advanceTo(getSampleTime(0));
+	{
+		ReferenceOutput output(*this, 0);
+		selectReferenceConfiguration(setlist.getCurrentFileIdx(), output);
+	}
+
+	// A MIDI effect has no audio channels
+	AudioBuffer<float> audio(0, blockSize);
+	MidiBuffer block;
+	size_t eventIdx = 0;
+	const int64 numSamples = (int64)(durationSeconds * PLUGIN_CHECK_SAMPLE_RATE) + blockSize;
+	for (blockStart = 0; blockStart < numSamples; blockStart += blockSize) {
+		const size_t firstBlockEvent = referenceEvents.size();
+		block.clear();
+		for (; eventIdx < events.size(); ++eventIdx) {
+			const int64 samplePosition = (int64)(events[eventIdx].time * PLUGIN_CHECK_SAMPLE_RATE);
+			if (samplePosition >= blockStart + blockSize) break;
+			const MidiMessage& message = events[eventIdx].message;
+			if (message.getRawDataSize() > 3) continue;
+			block.addEvent(message, (int)(samplePosition - blockStart));
+			referenceArpeggiator.advanceTo(getSampleTime(samplePosition));
+			ReferenceOutput output(*this, samplePosition);
+			referenceRouter.processMidiMessage(message, output);
+		}
+		referenceArpeggiator.advanceTo(getSampleTime(blockStart + blockSize - 1));
+		addReferenceSteps(firstBlockEvent);
+		processor.processBlock(audio, block);
+		MidiBuffer::Iterator iter(block);
+		MidiMessage message;
+		int samplePosition;
+		while (iter.getNextEvent(message, samplePosition)) blockEvents.push_back({ blockStart + samplePosition, message });
+	}
+	processor.releaseResources();
+	if (processor.getNumDropped() > 0) std::cout << "Dropped by full blocks: " << processor.getNumDropped() << std::endl;
+	return numMismatches + compareEvents();
+}
+
+int PluginHostCheck::compareEvents()
+{
+	int numMismatches = 0;
+	const size_t numCompared = jmin(blockEvents.size(), referenceEvents.size());
+	for (size_t idx = 0; idx < numCompared; ++idx) {
+		const RoutedEvent& blockEvent = blockEvents[idx];
+		const RoutedEvent& referenceEvent = referenceEvents[idx];
+		const bool isSame = blockEvent.samplePosition == referenceEvent.samplePosition
+			&& blockEvent.message.getRawDataSize() == referenceEvent.message.getRawDataSize()
+			&& std::memcmp(blockEvent.message.getRawData(), referenceEvent.message.getRawData(), (size_t)blockEvent.message.getRawDataSize()) == 0;
+		if (isSame) continue;
+		if (++numMismatches <= MAX_REPORTED_HOST_MISMATCHES) {
+			std::cout << "Mismatch at event " << idx << ": plugin " << blockEvent.message.getDescription() << " at sample " << blockEvent.samplePosition
+				<< ", application " << referenceEvent.message.getDescription() << " at sample " << referenceEvent.samplePosition << std::endl;
+		}
+	}
+	if (blockEvents.size() != referenceEvents.size()) {
+		std::cout << "The plugin routed " << (int64)blockEvents.size() << " events, the application " << (int64)referenceEvents.size() << std::endl;
+		numMismatches += (int)std::abs((int64)blockEvents.size() - (int64)referenceEvents.size());
+	}
+	std::cout << "Compared " << (int64)numCompared << " routed events: " << numMismatches << " mismatches" << std::endl;
+	return numMismatches;
+}
+
+void PluginHostCheck::selectReferenceConfiguration(int configurationIdx, ReferenceOutput& output)
+{
+	// As the plugin: silence everything, then select the new file
+	if (configurationIdx < 0 || configurationIdx >= referenceRouter.getNumConfigurations()) return;
+	for (int chIdx = 1; chIdx <= NUM_MIDI_CHANNELS; ++chIdx) {
+		output.routeMidiMessage(MidiMessage::allNotesOff(chIdx), DEFAULT_OUTPUT_PORT);
+	}
+	referenceRouter.selectConfiguration(configurationIdx, output);
+}
+
+double PluginHostCheck::getSampleTime(int64 samplePosition)
+{
+	return ARPEGGIATOR_SAMPLE_CLOCK_START + samplePosition / PLUGIN_CHECK_SAMPLE_RATE;
+}
+
+void PluginHostCheck::addReferenceSteps(size_t firstBlockEvent)
+{
+	referenceEvents.insert(referenceEvents.end(), referenceSteps.begin(), referenceSteps.end());
+	referenceSteps.clear();
+	std::stable_sort(referenceEvents.begin() + (std::ptrdiff_t)firstBlockEvent, referenceEvents.end(),
+		[](const RoutedEvent& a, const RoutedEvent& b) { return a.samplePosition < b.samplePosition; });
+}
+
+void PluginHostCheck::ReferenceOutput::routeMidiMessage(const MidiMessage& message, int /*port*/)
+{
+	owner.referenceEvents.push_back({ samplePosition, message });
+}
+
+void PluginHostCheck::ReferenceOutput::songChangeRequested(int delta)
+{
+	owner.selectReferenceConfiguration(owner.referenceRouter.getCurrentConfigurationIdx() + delta, *this);
+}
+
+void PluginHostCheck::ReferenceArpeggiatorOutput::routeMidiMessage(const MidiMessage& message, int /*port*/)
+{
+	const double position = (message.getTimeStamp() - getSampleTime(owner.blockStart)) * PLUGIN_CHECK_SAMPLE_RATE;
+	owner.referenceSteps.push_back({ owner.blockStart + jlimit(0, jmax(0, owner.blockSize - 1), roundToInt(position)), message });
+}
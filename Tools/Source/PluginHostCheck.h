@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/Setlist.h"
+#include "../../Source/ZoneRouter.h"
+#include "../../Source/Arpeggiator.h"
+#include "../../Plugin/Source/PluginProcessor.h"
+#include "MidiStormGenerator.h"
+
+#define DEFAULT_PLUGIN_CHECK_DURATION 10.0
+#define DEFAULT_PLUGIN_CHECK_BLOCK_SIZE 512
+#define PLUGIN_CHECK_SAMPLE_RATE 48000.0
+#define MAX_REPORTED_HOST_MISMATCHES 10
+
+// Drives the processor of the plugin as a host does: the setlist is restored from a saved
+// state, then every block goes through prepareToPlay and processBlock (one MidiBuffer per
+// block, events at their sample offset). What comes out is compared with the routing of the
+// application, one message at a time, of the same events; its arpeggiator runs on the clock
+// of the samples, as the one of the plugin, and the notes of its random mode cannot match.
+// SysEx is passed through by the
+// plugin and is not routed, so it is left out. The plugin binary itself is not loaded: the
+// JUCE version of the project builds no plugin format that a Linux host can load.
+class PluginHostCheck
+{
+public:
+	PluginHostCheck();
+	~PluginHostCheck();
+
+	// Loads the reference routing and gives the same files to the plugin in its state
+	bool loadSetlist(const File& directory, const File& ccMappingFile);
+	void addStorm(MidiStormGenerator::Storm storm, int64 seed);
+
+	// Returns the number of mismatches
+	int run(double durationSeconds, int blockSize);
+
+private:
+	struct RoutedEvent
+	{
+		int64 samplePosition;
+		MidiMessage message;
+	};
+
+	// Collects the messages of the application routing, as the plugin does on a song change
+	class ReferenceOutput : public ZoneRouter::Output
+	{
+	public:
+		ReferenceOutput(PluginHostCheck& o, int64 position)
+			: owner(o), samplePosition(position)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+		void songChangeRequested(int delta) override;
+
+		PluginHostCheck& owner;
+		int64 samplePosition;
+	};
+
+	// Collects the steps of the reference arpeggiator at the sample of their time, in the
+	// current block as the plugin does
+	class ReferenceArpeggiatorOutput : public ZoneRouter::Output
+	{
+	public:
+		ReferenceArpeggiatorOutput(PluginHostCheck& o)
+			: owner(o)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+
+		PluginHostCheck& owner;
+	};
+
+	void selectReferenceConfiguration(int configurationIdx, ReferenceOutput& output);
+	static double getSampleTime(int64 samplePosition);
+	// Adds the steps of a block to the reference events from firstBlockEvent, after the events of their sample
+	void addReferenceSteps(size_t firstBlockEvent);
+	// Returns false if the state saved by the plugin is not the one it was given
+	bool checkSavedState();
+	int compareEvents();
+
+	Setlist setlist;
+	ZonifierAudioProcessor processor;
+	MemoryBlock restoredState;
+	ZoneRouter referenceRouter;
+	OwnedArray<MidiStormGenerator> generators;
+
+	std::vector<RoutedEvent> blockEvents;
+	std::vector<RoutedEvent> referenceEvents;
+	std::vector<RoutedEvent> referenceSteps;
+	int64 blockStart = 0;
+	int blockSize = 0;
+
+	// After everything its output uses
+	ReferenceArpeggiatorOutput referenceArpeggiatorOutput;
+	Arpeggiator referenceArpeggiator;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginHostCheck)
+};
@@ -0,0 +1,14 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PreciseWait.h"
+
+double getPreciseTime()
+{
+	return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+void waitUntilPreciseTime(double time)
+{
+	for (double remainingMs = (time - getPreciseTime()) * 1000.0; remainingMs > 0.0; remainingMs = (time - getPreciseTime()) * 1000.0) {
+		if (remainingMs > 2.0) Thread::sleep((int)remainingMs - 1);
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+// Current time in seconds, on the clock of the time stamps of the JUCE MIDI inputs
+double getPreciseTime();
+
+// Waits until the given time of getPreciseTime(): sleeps for most of the wait, then spins
+// for the last millisecond, since a sleep can overshoot by more than the timing measured
+void waitUntilPreciseTime(double time);
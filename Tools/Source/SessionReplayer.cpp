@@ -0,0 +1,197 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SessionReplayer.h"
+#include "PreciseWait.h"
+
+SessionReplayer::SessionReplayer() : arpeggiatorOutput(*this), arpeggiator(arpeggiatorOutput, false)
+{
+	router.setArpeggiator(&arpeggiator);
+}
+
+SessionReplayer::~SessionReplayer()
+{
+	router.setArpeggiator(nullptr);
+}
+
+bool SessionReplayer::loadSetlist(const File& directory, const File& ccMappingFile)
+{
+	if (directory != File() && !setlist.loadDirectory(directory)) return false;
+	if (ccMappingFile != File() && !setlist.loadCCMappingFile(ccMappingFile)) return false;
+	// The router gets the setlist once the source ids of the log are known
+	return true;
+}
+
+void SessionReplayer::setTiming(Timing newTiming, double newSpeed)
+{
+	timing = newTiming;
+	speed = newSpeed > 0.0 ? newSpeed : 1.0;
+}
+
+void SessionReplayer::setVerbose(bool shouldBeVerbose)
+{
+	verbose = shouldBeVerbose;
+}
+
+bool SessionReplayer::setMidiOutput(const String& deviceName, bool useVirtualPort)
+{
+	// The opened output does not depend on the backend that opened it
+	JuceMidiBackend backend(useVirtualPort);
+	midiOutputDevice = backend.openOutput(deviceName);
+	return midiOutputDevice != nullptr;
+}
+
+int SessionReplayer::replay(const File& logFile)
+{
+	if (!SessionRecorder::readLog(logFile, header, sourceNames, records)) return -1;
+	if (records.empty()) return 0;
+	resolveInputSources();
+	checkArpeggiatedZones();
+
+	// The dropped outputs were routed too, the replay produces them
+	expectedOutputs.clear();
+	int numDroppedOutputs = 0;
+	for (auto& record : records) {
+		if (!isOutputRecord(record) || record.size > RECORD_DATA_SIZE) continue;
+		expectedOutputs.push_back(record);
+		if (record.type == SessionRecorder::droppedOutputEvent) ++numDroppedOutputs;
+	}
+	nextExpectedOutput = 0;
+	numReplayedOutputs = 0;
+	numMismatches = 0;
+	firstRecordTicks = records.front().ticks;
+	replayStartTime = getPreciseTime();
+	arpeggiatorTime = getRecordTime(firstRecordTicks);
+	arpeggiator.advanceTo(arpeggiatorTime);
+
+	ReplayOutput output(*this);
+	int numInputs = 0;
+	for (auto& record : records) {
+		if (isOutputRecord(record)) continue;
+		const double recordTime = getRecordTime(record.ticks);
+		playArpeggiatorUntil(recordTime);
+		waitUntil(recordTime);
+		if (verbose) std::cout << describeRecord(record) << std::endl;
+		if (record.type == SessionRecorder::setlistSwitch) {
+			router.selectConfiguration(SessionRecorder::getSetlistSwitchFileIdx(record), output);
+		}
+		else if (record.type == SessionRecorder::inputEvent) {
+			// Long SysEx messages are only partially recorded and cannot be replayed
+			if (record.size > RECORD_DATA_SIZE) continue;
+			// The ids of the sources are the ones of the log (ANY_INPUT_SOURCE is recorded as 0xFF)
+			const int sourceId = record.source < MAX_INPUT_SOURCES ? (int)record.source : ANY_INPUT_SOURCE;
+			const MidiMessage message(record.data, jmin((int)record.size, RECORD_DATA_SIZE), 0.0);
+			arpeggiator.handleSyncMessage(message, recordTime);
+			router.processMidiMessage(message, output, sourceId);
+			++numInputs;
+		}
+	}
+	// The steps recorded after the last input
+	playArpeggiatorUntil(getRecordTime(records.back().ticks));
+	numMismatches += (int)(expectedOutputs.size() - jmin(expectedOutputs.size(), nextExpectedOutput));
+
+	std::cout << "Replayed " << numInputs << " input events: " << numReplayedOutputs << " output events, "
+		<< expectedOutputs.size() << " recorded (" << numDroppedOutputs << " dropped by the application), " << numMismatches << " mismatches" << std::endl;
+	return numMismatches;
+}
+
+void SessionReplayer::resolveInputSources()
+{
+	// As the application; devices of the files missing from the log play the zones of any device
+	if (sourceNames.isEmpty()) std::cout << "The log has no source names: every input uses the zones of any device" << std::endl;
+	auto configurations = setlist.getConfigurations();
+	for (auto& configuration : configurations) {
+		for (auto& device : configuration.devices) {
+			device.sourceId = device.inDevice.isEmpty() ? ANY_INPUT_SOURCE : sourceNames.indexOf(device.inDevice);
+		}
+		Setlist::compileDeviceOfSource(configuration);
+	}
+	router.setConfigurations(std::move(configurations));
+	auto mapping = setlist.getCCMapping();
+	for (auto& device : mapping.devices) {
+		device.sourceId = device.inDevice.isEmpty() ? ANY_INPUT_SOURCE : sourceNames.indexOf(device.inDevice);
+	}
+	Setlist::compileDeviceOfSource(mapping);
+	router.setCCMapping(std::move(mapping));
+}
+
+void SessionReplayer::checkArpeggiatedZones()
+{
+	bool hasArpeggiatedZones = false;
+	auto& configurations = setlist.getConfigurations();
+	for (int fileIdx = 0; fileIdx < (int)configurations.size(); ++fileIdx) {
+		for (auto& device : configurations[fileIdx].devices) {
+			for (auto& zones : device.zones) {
+				for (auto& zone : zones) {
+					if (!zone.hasArpeggiator) continue;
+					hasArpeggiatedZones = true;
+					if (zone.arpeggiator.mode == ArpeggiatorSettings::randomMode)
+						std::cout << "Unsupported: a zone of " << setlist.getFileName(fileIdx) << " has a random arpeggiator, its notes cannot match the recorded ones" << std::endl;
+				}
+			}
+		}
+	}
+	// The tempo detected on the audio input is not in the log
+	if (hasArpeggiatedZones)
+		std::cout << "The arpeggiated zones follow the recorded MIDI clock (" << DEFAULT_ARPEGGIATOR_TEMPO << " BPM without one), not the tempo of the audio input" << std::endl;
+}
+
+double SessionReplayer::getRecordTime(int64 recordTicks)
+{
+	return recordTicks / (double)header.ticksPerSecond;
+}
+
+void SessionReplayer::waitUntil(double recordTime)
+{
+	if (timing == instant) return;
+	const double recordSeconds = recordTime - getRecordTime(firstRecordTicks);
+	const double replaySeconds = timing == accelerated ? recordSeconds / speed : recordSeconds;
+	waitUntilPreciseTime(replayStartTime + replaySeconds);
+}
+
+void SessionReplayer::playArpeggiatorUntil(double recordTime)
+{
+	if (timing != instant) {
+		// As the thread of the application: every step is sent at its time
+		for (double nextTime = arpeggiator.advanceTo(arpeggiatorTime); nextTime > 0.0 && nextTime <= recordTime; nextTime = arpeggiator.advanceTo(nextTime)) {
+			waitUntil(nextTime);
+		}
+	}
+	arpeggiator.advanceTo(recordTime);
+	arpeggiatorTime = recordTime;
+}
+
+void SessionReplayer::ReplayOutput::routeMidiMessage(const MidiMessage& message, int /*port*/)
+{
+	if (owner.midiOutputDevice != nullptr) owner.midiOutputDevice->sendMessageNow(message);
+	owner.compareOutput(message);
+}
+
+void SessionReplayer::compareOutput(const MidiMessage& message)
+{
+	++numReplayedOutputs;
+	if (nextExpectedOutput >= expectedOutputs.size()) {
+		if (++numMismatches <= MAX_REPORTED_MISMATCHES)
+			std::cout << "Unexpected output: " << message.getDescription() << std::endl;
+		return;
+	}
+	const SessionRecorder::Record& expected = expectedOutputs[nextExpectedOutput++];
+	const int size = jmin(message.getRawDataSize(), RECORD_DATA_SIZE);
+	if (expected.size != message.getRawDataSize() || memcmp(expected.data, message.getRawData(), (size_t)size) != 0) {
+		if (++numMismatches <= MAX_REPORTED_MISMATCHES)
+			std::cout << "Mismatch: replayed " << message.getDescription() << ", recorded " << describeRecord(expected) << std::endl;
+	}
+	if (verbose) std::cout << "  -> " << message.getDescription() << std::endl;
+}
+
+String SessionReplayer::describeRecord(const SessionRecorder::Record& record)
+{
+	if (record.type == SessionRecorder::setlistSwitch)
+		return "Setlist switch to file " + String(SessionRecorder::getSetlistSwitchFileIdx(record) + 1);
+	MidiMessage message(record.data, jmin((int)record.size, RECORD_DATA_SIZE), 0.0);
+	const String kind = record.type == SessionRecorder::inputEvent ? "Input " : record.type == SessionRecorder::droppedOutputEvent ? "Dropped output " : "Output ";
+	return kind + String(record.source) + ": " + message.getDescription();
+}
+
+bool SessionReplayer::isOutputRecord(const SessionRecorder::Record& record)
+{
+	return record.type == SessionRecorder::outputEvent || record.type == SessionRecorder::droppedOutputEvent;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/Setlist.h"
+#include "../../Source/ZoneRouter.h"
+#include "../../Source/SessionRecorder.h"
+#include "../../Source/JuceMidiBackend.h"
+#include "../../Source/Arpeggiator.h"
+
+#define MAX_REPORTED_MISMATCHES 20
+
+// Feeds the input events and setlist switches of a session log back through the routing,
+// and checks that the same output events are produced. Every input event is routed with
+// the tables of its device, found by the source names of the log. The arpeggiated zones
+// are played by an arpeggiator on the clock of the log, with the tempo of the recorded MIDI
+// clock.
+class SessionReplayer
+{
+public:
+	enum Timing
+	{
+		instant,
+		realtime,
+		accelerated
+	};
+
+	SessionReplayer();
+	~SessionReplayer();
+
+	bool loadSetlist(const File& directory, const File& ccMappingFile);
+	void setTiming(Timing newTiming, double newSpeed = 1.0);
+	void setVerbose(bool shouldBeVerbose);
+	// With a virtual port the output is created with this name, for other programs to connect to
+	bool setMidiOutput(const String& deviceName, bool useVirtualPort = false);
+
+	// Returns the number of output events that differ from the recorded ones, -1 on error
+	int replay(const File& logFile);
+
+private:
+	// Collects the replayed output; Program Changes 0 and 1 are ignored because
+	// the song changes they caused are in the log as setlist switches
+	class ReplayOutput : public ZoneRouter::Output
+	{
+	public:
+		ReplayOutput(SessionReplayer& o)
+			: owner(o)
+		{}
+
+		void routeMidiMessage(const MidiMessage& message, int port) override;
+
+		SessionReplayer& owner;
+	};
+
+	void resolveInputSources();
+	// Reports the arpeggiated zones whose output cannot be the recorded one
+	void checkArpeggiatedZones();
+	// Seconds on the clock of the log
+	double getRecordTime(int64 recordTicks);
+	void waitUntil(double recordTime);
+	// Plays the steps of the arpeggiator until the time of the next record
+	void playArpeggiatorUntil(double recordTime);
+	void compareOutput(const MidiMessage& message);
+	static String describeRecord(const SessionRecorder::Record& record);
+	static bool isOutputRecord(const SessionRecorder::Record& record);
+
+	Setlist setlist;
+	ZoneRouter router;
+
+	Timing timing = instant;
+	double speed = 1.0;
+	bool verbose = false;
+	std::unique_ptr<MidiBackend::Output> midiOutputDevice;
+
+	// Replay state
+	SessionRecorder::Header header;
+	StringArray sourceNames;
+	std::vector<SessionRecorder::Record> records;
+	std::vector<SessionRecorder::Record> expectedOutputs;
+	size_t nextExpectedOutput = 0;
+	int numReplayedOutputs = 0;
+	int numMismatches = 0;
+	int64 firstRecordTicks = 0;
+	double arpeggiatorTime = 0.0;
+	double replayStartTime = 0.0;
+
+	// After everything its output uses: the arpeggiator ends its sounding notes when it is deleted
+	ReplayOutput arpeggiatorOutput;
+	Arpeggiator arpeggiator;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SessionReplayer)
+};
@@ -0,0 +1,198 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SoakTest.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_WINDOWS
+ #include <Windows.h>
+ #include <Psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#endif
+
+SoakTest::SoakTest(LoopbackHarness& h) : harness(h), heldNotes((size_t)(HARNESS_MAX_OUTPUT_PORTS * NUM_MIDI_CHANNELS * NUM_MIDI_NOTES), 0)
+{
+}
+
+SoakTest::~SoakTest()
+{
+}
+
+void SoakTest::addStorm(MidiStormGenerator::Storm storm, int64 seed)
+{
+	generators.add(new MidiStormGenerator(storm, seed + generators.size(), harness.getInputNames().size()));
+}
+
+int SoakTest::run(double durationSeconds, double reportIntervalSeconds)
+{
+	startMemory = getResidentMemory();
+	double nextReportTime = reportIntervalSeconds;
+	harness.start();
+
+	for (double windowEnd = SOAK_WINDOW_SECONDS; ; windowEnd += SOAK_WINDOW_SECONDS) {
+		const bool isLastWindow = windowEnd >= durationSeconds;
+		if (isLastWindow) windowEnd = durationSeconds;
+		events.clear();
+		for (auto generator : generators) generator->generate(windowEnd, events);
+		if (isLastWindow) {
+			for (auto generator : generators) generator->finish(windowEnd, events);
+		}
+		std::stable_sort(events.begin(), events.end(), [](const LoopbackHarness::Event& a, const LoopbackHarness::Event& b) { return a.time < b.time; });
+		harness.injectEvents(events);
+		harness.dispatchMonitorMessages(isLastWindow ? SOAK_FINAL_DISPATCH_TIMEOUT_MS : SOAK_DISPATCH_TIMEOUT_MS);
+		if (isLastWindow) harness.waitForOutputs();
+		harness.takeCapturedEvents(capturedEvents);
+		checkOutputs(capturedEvents);
+
+		if (windowEnd >= nextReportTime || isLastWindow) {
+			printReport(windowEnd, intervalLatencies);
+			intervalLatencies.reset();
+			nextReportTime += reportIntervalSeconds;
+		}
+		if (isLastWindow) break;
+	}
+
+	// Invariants
+	int numBroken = 0;
+	// What was queued and not dropped must have reached the outputs
+	const int64 numLost = harness.getNumRoutedEvents() - harness.getNumDroppedEvents() - numCapturedEvents;
+	std::cout << std::endl << "Total: " << harness.getNumInjectedEvents() << " injected, " << harness.getNumRoutedEvents() << " routed, "
+		<< numCapturedEvents << " received, " << harness.getNumDroppedEvents() << " dropped" << std::endl;
+	std::cout << "Latency (ms): 50% " << totalLatencies.getPercentile(50.0) << ", 99% " << totalLatencies.getPercentile(99.0)
+		<< ", 99.9% " << totalLatencies.getPercentile(99.9) << ", max " << totalLatencies.getMaximum() << std::endl;
+	std::cout << "Queue high-water mark: " << maxQueueHighWaterMark << " of " << SENDER_QUEUE_SIZE << std::endl;
+	if (harness.getNumDroppedEvents() > 0) {
+		std::cout << "FAILED: " << harness.getNumDroppedEvents() << " messages dropped by the output queues" << std::endl;
+		++numBroken;
+	}
+	if (numLost != 0 || harness.getNumLostCaptures() > 0) {
+		std::cout << "FAILED: " << numLost << " messages lost between the queues and the outputs" << std::endl;
+		++numBroken;
+	}
+	if (getNumHeldNotes() > 0) {
+		std::cout << "FAILED: " << getNumHeldNotes() << " Note Ons without Note Off" << std::endl;
+		++numBroken;
+	}
+	if (harness.getNumPendingMonitorMessages() > 0) {
+		std::cout << "FAILED: " << harness.getNumPendingMonitorMessages() << " monitor messages not delivered by the message thread" << std::endl;
+		++numBroken;
+	}
+	const int64 numCountedOutputs = harness.getNumCountedOutputs();
+	const int64 numCountedDropped = harness.getNumCountedDropped();
+	if (numCountedOutputs + numCountedDropped != harness.getNumRoutedEvents() - harness.getNumSilencingEvents()) {
+		std::cout << "FAILED: the traffic counters show " << numCountedOutputs << " sent and " << numCountedDropped << " dropped messages" << std::endl;
+		++numBroken;
+	}
+	if (harness.getNumOscDropped() > 0) std::cout << "Note: " << harness.getNumOscDropped() << " events dropped by the OSC queue" << std::endl;
+	if (numUnpairedNoteOffs > 0) std::cout << "Note: " << numUnpairedNoteOffs << " Note Offs without Note On" << std::endl;
+	return numBroken;
+}
+
+void SoakTest::checkOutputs(const std::vector<LoopbackMidiBackend::CapturedEvent>& captured)
+{
+	numCapturedEvents += (int64)captured.size();
+	for (auto& event : captured) {
+		const double latency = LoopbackHarness::getLatency(event);
+		if (latency >= 0.0) {
+			intervalLatencies.add(latency);
+			totalLatencies.add(latency);
+		}
+		const MidiMessage& message = event.message;
+		const int channel = message.getChannel();
+		if (channel < 1 || event.outputIdx < 0 || event.outputIdx >= HARNESS_MAX_OUTPUT_PORTS) continue;
+		int* channelNotes = &heldNotes[(size_t)((event.outputIdx * NUM_MIDI_CHANNELS + channel - 1) * NUM_MIDI_NOTES)];
+		if (message.isNoteOn()) {
+			++channelNotes[message.getNoteNumber()];
+		}
+		else if (message.isNoteOff()) {
+			if (channelNotes[message.getNoteNumber()] > 0) --channelNotes[message.getNoteNumber()];
+			else ++numUnpairedNoteOffs;
+		}
+		else if (message.isAllNotesOff()) {
+			std::fill(channelNotes, channelNotes + NUM_MIDI_NOTES, 0);
+		}
+	}
+}
+
+int SoakTest::getNumHeldNotes()
+{
+	int numHeld = 0;
+	for (int held : heldNotes) numHeld += held;
+	return numHeld;
+}
+
+void SoakTest::printReport(double elapsedSeconds, const LatencyHistogram& latencies)
+{
+	const int highWaterMark = harness.getQueueHighWaterMark();
+	harness.resetQueueHighWaterMarks();
+	maxQueueHighWaterMark = jmax(maxQueueHighWaterMark, highWaterMark);
+	const int64 memory = getResidentMemory();
+
+	std::cout << "[" << String(elapsedSeconds, 1) << " s] " << harness.getNumInjectedEvents() << " injected, "
+		<< harness.getNumRoutedEvents() << " routed, " << harness.getNumDroppedEvents() << " dropped"
+		<< " | latency (ms) 50% " << latencies.getPercentile(50.0) << ", 99% " << latencies.getPercentile(99.0)
+		<< ", 99.9% " << latencies.getPercentile(99.9) << ", max " << latencies.getMaximum()
+		<< " | queue high-water " << highWaterMark << " | held notes " << getNumHeldNotes()
+		<< " | monitor backlog " << harness.getNumPendingMonitorMessages();
+	if (memory >= 0)
+		std::cout << " | memory " << memory / 1024 << " KB (" << (memory - startMemory >= 0 ? "+" : "") << (memory - startMemory) / 1024 << " KB)";
+	std::cout << std::endl;
+}
+
+int64 SoakTest::getResidentMemory()
+{
+#if JUCE_LINUX
+	// Second field of statm: resident pages
+	StringArray fields = StringArray::fromTokens(File("/proc/self/statm").loadFileAsString(), false);
+	if (fields.size() < 2) return -1;
+	return fields[1].getLargeIntValue() * (int64)sysconf(_SC_PAGESIZE);
+#elif JUCE_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return -1;
+	return (int64)counters.WorkingSetSize;
+#else
+	return -1;
+#endif
+}
+
+SoakTest::LatencyHistogram::LatencyHistogram() : buckets((size_t)(LATENCY_HISTOGRAM_MAX_MS / LATENCY_HISTOGRAM_RESOLUTION_MS) + 1, 0)
+{
+}
+
+void SoakTest::LatencyHistogram::add(double latencyMs)
+{
+	// The last bucket collects everything above the maximum
+	const size_t bucket = (size_t)jlimit(0, (int)buckets.size() - 1, (int)(latencyMs / LATENCY_HISTOGRAM_RESOLUTION_MS));
+	++buckets[bucket];
+	++count;
+	maximum = jmax(maximum, latencyMs);
+}
+
+void SoakTest::LatencyHistogram::reset()
+{
+	std::fill(buckets.begin(), buckets.end(), 0);
+	count = 0;
+	maximum = 0.0;
+}
+
+int64 SoakTest::LatencyHistogram::getCount() const
+{
+	return count;
+}
+
+double SoakTest::LatencyHistogram::getPercentile(double percentile) const
+{
+	if (count == 0) return 0.0;
+	const int64 rank = jmax((int64)1, (int64)std::ceil(percentile / 100.0 * count));
+	int64 cumulated = 0;
+	for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+		cumulated += buckets[bucket];
+		// Upper bound of the bucket
+		if (cumulated >= rank) return jmin(maximum, (bucket + 1) * LATENCY_HISTOGRAM_RESOLUTION_MS);
+	}
+	return maximum;
+}
+
+double SoakTest::LatencyHistogram::getMaximum() const
+{
+	return maximum;
+}
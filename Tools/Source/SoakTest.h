@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoopbackHarness.h"
+#include "MidiStormGenerator.h"
+
+#define SOAK_WINDOW_SECONDS 0.1
+#define DEFAULT_SOAK_REPORT_INTERVAL 10.0
+#define LATENCY_HISTOGRAM_RESOLUTION_MS 0.01
+#define LATENCY_HISTOGRAM_MAX_MS 100.0
+// Time given to the message thread after every window, and at the end of the run
+#define SOAK_DISPATCH_TIMEOUT_MS 50
+#define SOAK_FINAL_DISPATCH_TIMEOUT_MS 5000
+
+// Drives storms through the loopback harness for a long time, a window of events after
+// the other, and checks what comes out of the outputs:
+// - every Note On is followed by its Note Off (or an All Notes Off) on the same output
+// - every routed message reaches its output: nothing is dropped by the queues
+// - the traffic counters agree with the queues, and with the consumers of the application
+//   the message thread shows every routed message on the monitor
+// It reports latency percentiles, queue high-water marks and the memory of the process.
+class SoakTest
+{
+public:
+	SoakTest(LoopbackHarness& harness);
+	~SoakTest();
+
+	void addStorm(MidiStormGenerator::Storm storm, int64 seed);
+
+	// Returns the number of broken invariants
+	int run(double durationSeconds, double reportIntervalSeconds = DEFAULT_SOAK_REPORT_INTERVAL);
+
+private:
+	// Fixed buckets, so that hours of latencies take no more memory than a few seconds
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void add(double latencyMs);
+		void reset();
+		int64 getCount() const;
+		double getPercentile(double percentile) const;
+		double getMaximum() const;
+
+	private:
+		std::vector<int64> buckets;
+		int64 count = 0;
+		double maximum = 0.0;
+	};
+
+	void checkOutputs(const std::vector<LoopbackMidiBackend::CapturedEvent>& events);
+	int getNumHeldNotes();
+	void printReport(double elapsedSeconds, const LatencyHistogram& latencies);
+	static int64 getResidentMemory();
+
+	LoopbackHarness& harness;
+	OwnedArray<MidiStormGenerator> generators;
+
+	// Notes held on every output port, channel and note
+	std::vector<int> heldNotes;
+	int64 numUnpairedNoteOffs = 0;
+	int64 numCapturedEvents = 0;
+
+	LatencyHistogram intervalLatencies;
+	LatencyHistogram totalLatencies;
+	int maxQueueHighWaterMark = 0;
+	int64 startMemory = 0;
+
+	std::vector<LoopbackHarness::Event> events;
+	std::vector<LoopbackMidiBackend::CapturedEvent> capturedEvents;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoakTest)
+};